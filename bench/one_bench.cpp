@@ -0,0 +1,313 @@
+// one_bench.cpp
+// Microbenchmarks of one / oneR acquire and release, for each registry.
+// Build: g++ -std=c++20 -O2 -pthread -I.. one_bench.cpp -o one_bench
+// Run:   ./one_bench [milliseconds per case = 200] [max threads = 128] [max registry size = 1000000]
+// Each line is one case: ops/s counts acquire + release pairs of all the threads, the percentiles are of one pair.
+// Latencies include reading the clock twice (some tens of nanoseconds).
+// The teardown lines time destroying 100k held guards (10k for the linear list), e.g. at shutdown.
+// The types lines run a type per thread (own registry, own keys), scaling is their ops/s over one thread's.
+// Both layouts: build it again with -DONE_NO_PADDING -o one_bench_packed and compare the padded / packed lines.
+
+#include "one.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bench {
+    template <typename Registry>
+    struct obj {
+        int v = 0;
+    };
+    // Registry with its nodes from poolAllocator.
+    template <typename Registry>
+    struct pooled {
+        template <typename Key, typename Alloc, typename Lock>
+        using type = typename Registry::template type<Key, one::poolAllocator, Lock>;
+    };
+    // Registry locked by adaptiveMutex.
+    template <typename Registry>
+    struct spinning {
+        template <typename Key, typename Alloc, typename Lock>
+        using type = typename Registry::template type<Key, Alloc, one::adaptiveMutex>;
+    };
+    // Registry with threadAffinity, a thread keeps leases on the 64 keys it cycles through.
+    template <typename Registry>
+    struct affine {};
+    // The I-th of distinct types with Registry, each has registry state of its own.
+    template <std::size_t I, typename Registry>
+    struct multi {};
+} // namespace bench
+
+template <typename Registry, typename Key>
+struct one::oneTraits<bench::obj<Registry>, Key> {
+    using registry = Registry;
+};
+template <std::size_t I, typename Registry, typename Key>
+struct one::oneTraits<bench::obj<bench::multi<I, Registry>>, Key> {
+    using registry = Registry;
+};
+template <typename Registry, typename Key>
+struct one::oneTraits<bench::obj<bench::affine<Registry>>, Key> {
+    using registry = Registry;
+    using affinity = threadAffinity<64>;
+};
+
+namespace bench {
+    using clock = std::chrono::steady_clock;
+
+    struct options {
+        std::chrono::milliseconds duration{200};
+        unsigned maxThreads = 128;
+        std::size_t maxSize = 1000000;
+    };
+
+    template <typename Key>
+    Key makeKey(std::uint64_t i);
+    template <>
+    std::uint64_t makeKey<std::uint64_t>(std::uint64_t i) { return i; }
+    template <>
+    std::string makeKey<std::string>(std::uint64_t i) { return "/var/data/file-" + std::to_string(i) + ".log"; }
+    // The held conditions (from 2^40) in the upper half of the range.
+    using boundedKey = one::bounded<std::uint64_t(0), std::uint64_t(1) << 21>;
+    template <>
+    boundedKey makeKey<boundedKey>(std::uint64_t i) { return boundedKey::at((i >> 40 ? std::size_t(1) << 20 : 0) + (i & ((std::uint64_t(1) << 20) - 1))); }
+
+    template <typename Key>
+    const char *keyName();
+    template <>
+    const char *keyName<std::uint64_t>() { return "uint64"; }
+    template <>
+    const char *keyName<std::string>() { return "string"; }
+    template <>
+    const char *keyName<boundedKey>() { return "bounded"; }
+
+    struct result {
+        double opsPerSecond;
+        double failRate;
+        std::chrono::nanoseconds p50, p99, p999;
+    };
+
+    // Every thread acquires and releases keys of its own (uncontended) or the same 4 keys as every other thread (contended),
+    // while size other conditions are held in the registry.
+    template <typename Guard, typename Key>
+    result run(const options &o, unsigned threads, std::size_t size, bool contended) {
+        using T = typename Guard::object;
+        std::vector<std::unique_ptr<one::one<T, Key>>> held;
+        held.reserve(size);
+        for (std::size_t i = 0; i < size; ++i)
+            held.push_back(std::make_unique<one::one<T, Key>>(one::Opt::notUseConditionConstructor{}, makeKey<Key>((std::uint64_t(1) << 40) + i)));
+
+        std::atomic<bool> start{false}, stop{false};
+        std::vector<std::vector<std::uint32_t>> samples(threads);
+        std::vector<std::uint64_t> done(threads), failed(threads);
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back([&, t] {
+                std::vector<Key> keys;
+                for (std::uint64_t i = 0; i < 64; ++i)
+                    keys.push_back(makeKey<Key>(contended ? (i & 3) : ((std::uint64_t(t + 1) << 20) + i)));
+                auto &s = samples[t];
+                s.reserve(1 << 20);
+                while (!start.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                std::uint64_t n = 0, f = 0;
+                for (; !stop.load(std::memory_order_relaxed); ++n) {
+                    auto begin = clock::now();
+                    if (!Guard::cycle(keys[n & 63]))
+                        ++f;
+                    auto end = clock::now();
+                    if (s.size() < s.capacity())
+                        s.push_back(static_cast<std::uint32_t>(std::min<std::int64_t>((end - begin).count(), UINT32_MAX)));
+                }
+                done[t] = n;
+                failed[t] = f;
+            });
+        auto begin = clock::now();
+        start.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(o.duration);
+        stop.store(true);
+        for (auto &t : pool)
+            t.join();
+        double seconds = std::chrono::duration<double>(clock::now() - begin).count();
+
+        std::vector<std::uint32_t> all;
+        std::uint64_t n = 0, f = 0;
+        for (unsigned t = 0; t < threads; ++t) {
+            all.insert(all.end(), samples[t].begin(), samples[t].end());
+            n += done[t];
+            f += failed[t];
+        }
+        std::sort(all.begin(), all.end());
+        auto at = [&](double q) {
+            return all.empty() ? std::chrono::nanoseconds(0) : std::chrono::nanoseconds(all[std::min(all.size() - 1, static_cast<std::size_t>(q * all.size()))]);
+        };
+        return {n / seconds, n ? double(f) / n : 0.0, at(0.5), at(0.99), at(0.999)};
+    }
+
+    // One acquire + release.
+    template <typename Registry, typename Key>
+    struct oneGuard {
+        using object = obj<Registry>;
+        static bool cycle(const Key &k) {
+            one::one<object, Key> g;
+            return g.init(one::Opt::notUseConditionConstructor{}, k, std::chrono::milliseconds(5000));
+        }
+    };
+    template <typename Registry, typename Key>
+    struct oneRGuard {
+        using object = obj<Registry>;
+        static bool cycle(const Key &k) {
+            one::oneR<object, Key> g;
+            return g.init(one::Opt::notUseConditionConstructor{}, k, std::chrono::milliseconds(5000));
+        }
+    };
+
+    // One probe with tryAcquire, a conflict throws nothing.
+    template <typename Registry, typename Key>
+    struct tryGuard {
+        using object = obj<Registry>;
+        static bool cycle(const Key &k) {
+            one::one<object, Key> g;
+            return g.tryAcquire(one::Opt::notUseConditionConstructor{}, k) == one::status::ok;
+        }
+    };
+
+    // Destroy size held guards, newest first, ret the mean release time. Grouped: inside a releaseGroup.
+    template <typename Registry, typename Key>
+    std::chrono::nanoseconds teardown(std::size_t size, bool grouped) {
+        using T = obj<Registry>;
+        std::vector<std::unique_ptr<one::one<T, Key>>> held;
+        held.reserve(size);
+        for (std::size_t i = 0; i < size; ++i)
+            held.push_back(std::make_unique<one::one<T, Key>>(one::Opt::notUseConditionConstructor{}, makeKey<Key>(i)));
+        auto begin = clock::now();
+        if (grouped) {
+            one::releaseGroup<T, Key> group;
+            held.clear();
+        } else
+            while (!held.empty())
+                held.pop_back();
+        return (clock::now() - begin) / std::max<std::size_t>(size, 1);
+    }
+
+    // one::padding, ONE_NO_PADDING packs the lock words, shards, wait buckets and per type state.
+    constexpr const char *layout = one::padding ? "padded" : "packed";
+
+    // Every thread acquires and releases its own keys of its own type (multi<thread>), so nothing is shared but
+    // the memory layout of the registries: ideally the ops/s grow with the threads.
+    constexpr std::size_t multiTypes = 64;
+    template <typename Registry, typename Key, std::size_t... I>
+    double multiRun(const options &o, unsigned threads, std::index_sequence<I...>) {
+        using cycleFn = bool (*)(const Key &);
+        static constexpr cycleFn cycles[] = {&oneGuard<multi<I, Registry>, Key>::cycle...};
+        std::atomic<bool> start{false}, stop{false};
+        std::vector<std::uint64_t> done(threads);
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back([&, t] {
+                cycleFn cycle = cycles[t % multiTypes];
+                std::vector<Key> keys;
+                for (std::uint64_t i = 0; i < 64; ++i)
+                    keys.push_back(makeKey<Key>((std::uint64_t(t + 1) << 20) + i));
+                while (!start.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                std::uint64_t n = 0;
+                for (; !stop.load(std::memory_order_relaxed); ++n)
+                    cycle(keys[n & 63]);
+                done[t] = n;
+            });
+        auto begin = clock::now();
+        start.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(o.duration);
+        stop.store(true);
+        for (auto &t : pool)
+            t.join();
+        double seconds = std::chrono::duration<double>(clock::now() - begin).count();
+        std::uint64_t n = 0;
+        for (auto d : done)
+            n += d;
+        return n / seconds;
+    }
+    template <typename Registry, typename Key>
+    void multiRegistry(const options &o, const char *name) {
+        double one = 0;
+        for (unsigned threads = 1; threads <= std::min<unsigned>(o.maxThreads, multiTypes); threads *= 2) {
+            double r = multiRun<Registry, Key>(o, threads, std::make_index_sequence<multiTypes>{});
+            if (threads == 1)
+                one = r;
+            std::printf("%-10s %-8s %-6s %7u %8s %-11s %13.0f scaling %.2fx %s\n", name, "one", keyName<Key>(), threads, "-", "types", r, one ? r / one : 0.0, layout);
+            std::fflush(stdout);
+        }
+    }
+
+    void header() {
+        std::printf("layout %s (one::cacheLine %zu)\n", layout, one::cacheLine);
+        std::printf("%-10s %-8s %-6s %7s %8s %-11s %13s %7s %9s %9s %9s\n", "registry", "guard", "key", "threads", "size", "mode", "ops/s", "fail", "p50(ns)", "p99(ns)", "p999(ns)");
+    }
+
+    template <template <typename, typename> class Guard, typename Registry, typename Key>
+    void line(const options &o, const char *registry, const char *guard, unsigned threads, std::size_t size, bool contended) {
+        result r = run<Guard<Registry, Key>, Key>(o, threads, size, contended);
+        std::printf("%-10s %-8s %-6s %7u %8zu %-11s %13.0f %6.1f%% %9lld %9lld %9lld\n", registry, guard, keyName<Key>(), threads, size,
+                    contended ? "contended" : "uncontended", r.opsPerSecond, r.failRate * 100, (long long)r.p50.count(), (long long)r.p99.count(), (long long)r.p999.count());
+        std::fflush(stdout);
+    }
+
+    template <typename Registry, typename Key>
+    void registry(const options &o, const char *name, std::size_t maxSize) {
+        // Registry size, one thread.
+        for (std::size_t size = 10; size <= std::min(maxSize, o.maxSize); size *= 100)
+            line<oneGuard, Registry, Key>(o, name, "one", 1, size, false);
+        line<oneRGuard, Registry, Key>(o, name, "oneR", 1, 10, false);
+        std::size_t size = std::min<std::size_t>({100000, maxSize, o.maxSize});
+        std::printf("%-10s %-8s %-6s teardown of %zu guards: %lld ns each\n", name, "one", keyName<Key>(), size, (long long)teardown<Registry, Key>(size, false).count());
+        std::printf("%-10s %-8s %-6s teardown of %zu guards: %lld ns each\n", name, "group", keyName<Key>(), size, (long long)teardown<Registry, Key>(size, true).count());
+        // Threads, with 1000 conditions held.
+        for (bool contended : {false, true})
+            for (unsigned threads = 1; threads <= o.maxThreads; threads *= 2)
+                line<oneGuard, Registry, Key>(o, name, "one", threads, std::min<std::size_t>(1000, o.maxSize), contended);
+        // Probes of the contended keys, init against tryAcquire.
+        line<tryGuard, Registry, Key>(o, name, "try", std::min(4u, o.maxThreads), std::min<std::size_t>(1000, o.maxSize), true);
+    }
+
+    template <typename Key>
+    void all(const options &o) {
+        // The linear list is O(n), do not wait for it at a million.
+        registry<one::vectorRegistry, Key>(o, "vector", 10000);
+        registry<one::hashRegistry, Key>(o, "hash", o.maxSize);
+        registry<pooled<one::hashRegistry>, Key>(o, "hashPool", o.maxSize);
+        registry<spinning<one::hashRegistry>, Key>(o, "hashSpin", o.maxSize);
+        registry<one::shardedRegistry<64>, Key>(o, "sharded64", o.maxSize);
+        registry<spinning<one::shardedRegistry<64>>, Key>(o, "shardSpin", o.maxSize);
+        registry<one::lockFreeRegistry, Key>(o, "lockFree", o.maxSize);
+        registry<affine<one::hashRegistry>, Key>(o, "hashAffine", o.maxSize);
+    }
+} // namespace bench
+
+int main(int argc, char **argv) {
+    bench::options o;
+    if (argc > 1)
+        o.duration = std::chrono::milliseconds(std::atol(argv[1]));
+    if (argc > 2)
+        o.maxThreads = static_cast<unsigned>(std::max(1L, std::atol(argv[2])));
+    if (argc > 3)
+        o.maxSize = static_cast<std::size_t>(std::max(10L, std::atol(argv[3])));
+    bench::header();
+    bench::all<std::uint64_t>(o);
+    bench::all<std::string>(o);
+    bench::registry<one::boundedRegistry, bench::boundedKey>(o, "bounded", std::size_t(1) << 20);
+    // A type per thread.
+    bench::multiRegistry<one::hashRegistry, std::uint64_t>(o, "hash");
+    bench::multiRegistry<one::shardedRegistry<16>, std::uint64_t>(o, "sharded16");
+    bench::multiRegistry<one::lockFreeRegistry, std::uint64_t>(o, "lockFree");
+    bench::multiRegistry<bench::spinning<one::hashRegistry>, std::uint64_t>(o, "hashSpin");
+}
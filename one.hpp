@@ -31,14 +31,39 @@ SOFTWARE.
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <coroutine>
+#include <functional>
+#include <list>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <semaphore>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
     // your exception type
     using theSameException = std::runtime_error;
     using timeOutException = std::runtime_error;
+    using overloadException = std::runtime_error;
 
 
 namespace one {
@@ -46,46 +71,2941 @@ namespace one {
     inline namespace Opt {
         // Indicates the use of the default constructor.
         struct notUseConditionConstructor{};
+        // If the same condition exists, wait until it is released (up to the time out) instead of throwing.
+        // The waiters of a condition are granted by priority (higher first), then by deadline (earlier first), then in
+        // arrival order; one past its deadline is not granted (nor woken) and times out, so the next one is granted.
+        // e.g. one::Opt::waitForRelease{.priority = 10, .deadline = start + std::chrono::milliseconds(20)}
+        // The time out still bounds the wait too, whichever ends first.
+        struct waitForRelease {
+            int priority = 0;
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        };
+        // Take the condition now, but construct the object using it on the first get() (or conversion), once even if
+        // several threads ask at the same time. If no one asks, it is never constructed.
+        struct lazy{};
     }; // namespace Opt
 
-    // base, save list
-    template <typename T, typename... Conditions>
-    class oneMethod {
+    // Result of acquiring a condition.
+    enum class status {
+        ok,
+        same,   // the same condition already exists
+        timeOut, // time out get lock
+        overload // too many threads are acquiring the type already (adaptiveTimeOut), the lock was not tried
+    };
+
+    // Hash hook for conditions, used by the hashed registries.
+    // For a custom condition type, specialize it (it should agree with operator ==):
+    /*
+    template <>
+    struct one::conditionHash<X> {
+        std::size_t operator()(const X &x) const noexcept { return std::hash<int>{}(x.i); }
+    };
+    */
+    template <typename C, typename = void>
+    struct conditionHash {};
+
+    template <typename C>
+    struct conditionHash<C, std::enable_if_t<std::is_default_constructible_v<std::hash<C>>>> {
+        inline std::size_t operator()(const C &c) const noexcept {
+            return std::hash<C>{}(c);
+        }
+    };
+
+    // Strings are hashed as views, so a lookup by std::string_view or const char* needs no std::string.
+    template <>
+    struct conditionHash<std::string> {
+        using is_transparent = void;
+        inline std::size_t operator()(std::string_view s) const noexcept {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+    template <>
+    struct conditionHash<std::wstring> {
+        using is_transparent = void;
+        inline std::size_t operator()(std::wstring_view s) const noexcept {
+            return std::hash<std::wstring_view>{}(s);
+        }
+    };
+
+    // An integer or enum condition within [Lo, Hi), known at compile time, e.g. one::one<Device, one::bounded<0, 1024>>.
+    // A single bounded condition uses boundedRegistry by default: a bit per value, so acquire and release are one
+    // atomic bit operation (no lock, no hash). Its nodes are allocated 64 values at a time, by the first acquire of one:
+    // a registry costs 2 bits per value (the bit, a page pointer / 64), and 64 nodes per range of 64 values used.
+    template <auto Lo, auto Hi>
+    struct bounded {
+        using value_type = decltype(Lo);
+        static_assert(std::is_same_v<value_type, decltype(Hi)>, "Lo and Hi should be of the same type");
+        static_assert(std::is_integral_v<value_type> || std::is_enum_v<value_type>, "bounded is for integers and enums");
+
     private:
-        static std::vector<std::tuple<Conditions...>> list;
-    protected:
-        static std::timed_mutex mtx;
+        static constexpr auto raw(value_type v) noexcept {
+            if constexpr (std::is_enum_v<value_type>)
+                return static_cast<std::underlying_type_t<value_type>>(v);
+            else
+                return v;
+        }
 
     public:
-        template <typename... Args>
-        static void add(Args&&... args) noexcept {
-            list.push_back(std::make_tuple(std::forward<Args...>(args...)));
+        static_assert(raw(Lo) < raw(Hi), "the range should not be empty");
+        // Number of values.
+        static constexpr std::size_t count = static_cast<std::size_t>(raw(Hi) - raw(Lo));
+
+        value_type value;
+
+        // throw std::out_of_range if v is not in [Lo, Hi)
+        constexpr bounded(value_type v) : value(v) {
+            if (raw(v) < raw(Lo) || !(raw(v) < raw(Hi)))
+                throw std::out_of_range("one: condition out of its bounds");
         }
+        constexpr operator value_type() const noexcept {
+            return value;
+        }
+        // Position of the value in [Lo, Hi).
+        constexpr std::size_t index() const noexcept {
+            return static_cast<std::size_t>(raw(value) - raw(Lo));
+        }
+        static constexpr bounded at(std::size_t i) noexcept {
+            return bounded(static_cast<value_type>(raw(Lo) + static_cast<decltype(raw(Lo))>(i)));
+        }
+        friend constexpr bool operator==(const bounded &, const bounded &) = default;
+        friend constexpr bool operator==(const bounded &b, value_type v) noexcept {
+            return b.value == v;
+        }
+    };
+    template <auto Lo, auto Hi>
+    struct conditionHash<bounded<Lo, Hi>> {
+        inline std::size_t operator()(const bounded<Lo, Hi> &b) const noexcept {
+            return std::hash<decltype(Lo)>{}(b.value);
+        }
+    };
 
-        static void add(std::tuple<Conditions...> &&t) noexcept {
-            list.push_back(t);
+    template <typename C>
+    inline constexpr bool isConditionHashable = std::is_invocable_r_v<std::size_t, const conditionHash<C> &, const C &>;
+
+    template <typename C, typename = void>
+    inline constexpr bool isTransparent = false;
+    template <typename C>
+    inline constexpr bool isTransparent<C, std::void_t<typename conditionHash<C>::is_transparent>> = true;
+
+    // An argument of type A can be looked up as the condition C without making a C: the same type,
+    // or a conditionHash<C> with is_transparent that hashes A the same as the equal C, and C == A.
+    template <typename C, typename A>
+    inline constexpr bool isBorrowable = std::is_same_v<C, A> || (isTransparent<C> && std::is_invocable_r_v<std::size_t, const conditionHash<C> &, const A &> && requires(const C &c, const A &a) { c == a; });
+
+    // The argument itself (forwarded, so an rvalue can be moved into the registry) if it is borrowable,
+    // otherwise a C made from it.
+    template <typename C, typename A>
+    inline decltype(auto) borrow(A &&a) {
+        if constexpr (isBorrowable<C, std::remove_cvref_t<A>>)
+            return std::forward<A>(a);
+        else
+            return C(static_cast<const std::remove_reference_t<A> &>(a));
+    }
+
+    inline constexpr std::size_t hashCombine(std::size_t seed, std::size_t h) noexcept {
+        return seed ^ (h + static_cast<std::size_t>(0x9e3779b97f4a7c15ULL) + (seed << 6) + (seed >> 2));
+    }
+
+    // Conditions compared by their value bits (integers, enums, pointers) that fit in a std::size_t together,
+    // e.g. std::tuple<std::uint16_t, Protocol, std::uint32_t>.
+    template <typename Key>
+    inline constexpr bool isKeyPackable = false;
+    template <typename... Conditions>
+    inline constexpr bool isKeyPackable<std::tuple<Conditions...>> =
+        ((std::is_integral_v<Conditions> || std::is_enum_v<Conditions> || std::is_pointer_v<Conditions>) && ...) &&
+        (sizeof(Conditions) + ... + 0) <= sizeof(std::size_t);
+
+    // A bijection of std::size_t (the finalizer of MurmurHash3), so packed conditions stay distinct.
+    inline constexpr std::size_t mixBits(std::size_t v) noexcept {
+        if constexpr (sizeof(std::size_t) == 8) {
+            v ^= v >> 33;
+            v *= static_cast<std::size_t>(0xff51afd7ed558ccdULL);
+            v ^= v >> 33;
+            v *= static_cast<std::size_t>(0xc4ceb9fe1a85ec53ULL);
+            v ^= v >> 33;
+        } else {
+            v ^= v >> 16;
+            v *= static_cast<std::size_t>(0x85ebca6bU);
+            v ^= v >> 13;
+            v *= static_cast<std::size_t>(0xc2b2ae35U);
+            v ^= v >> 16;
         }
-        template <typename... Args>
-        static bool verified(Args&&... args) noexcept {
-            return (std::find(list.begin(), list.end(), std::make_tuple(std::forward<Args...>(args...))) != list.end());
+        return v;
+    }
+
+    // conditionHash combined over all the conditions of the tuple.
+    // Also hashes a tuple of borrowed arguments (see borrow), the same as the equal condition tuple.
+    // Packable conditions are packed into one word instead, its hash is exact: equal hashes are equal conditions,
+    // so the registries compare the hash alone.
+    template <typename Key>
+    struct tupleHash;
+
+    template <typename... Conditions>
+    struct tupleHash<std::tuple<Conditions...>> {
+        static constexpr bool exact = isKeyPackable<std::tuple<Conditions...>>;
+
+        template <typename... Qs>
+        inline std::size_t operator()(const std::tuple<Qs...> &t) const noexcept {
+            if constexpr (exact)
+                return std::apply([](const Qs &...q) {
+                    std::size_t v = 0;
+                    std::size_t at = 0;
+                    auto put = [&v, &at](const auto &c) noexcept {
+                        std::memcpy(reinterpret_cast<unsigned char *>(&v) + at, &c, sizeof(c));
+                        at += sizeof(c);
+                    };
+                    (put(Conditions(q)), ...);
+                    return mixBits(v);
+                }, t);
+            else
+                return std::apply([](const Qs &...q) {
+                    std::size_t seed = 0;
+                    ((seed = hashCombine(seed, conditionHash<Conditions>{}(q))), ...);
+                    return seed;
+                }, t);
+        }
+    };
+    // Whether equal hashes of Hash are equal keys, then the key is not compared.
+    template <typename Hash>
+    inline constexpr bool isExactHash = requires { requires Hash::exact; };
+
+    template <typename Key>
+    inline constexpr bool isKeyHashable = false;
+    template <typename... Conditions>
+    inline constexpr bool isKeyHashable<std::tuple<Conditions...>> = (isConditionHashable<Conditions> && ...);
+
+    // Bytes hook of conditions, for the registries that hold them outside the process (see backedStorage):
+    // equal conditions should give the same bytes, in every process. For a custom condition type, specialize it:
+    /*
+    template <>
+    struct one::conditionCodec<X> {
+        template <typename A, typename Out>
+        static void encode(const A &x, Out &out) noexcept { out.append(&x.i, sizeof(x.i)); }
+    };
+    */
+    // encode takes what the condition is looked up by too (see borrow), e.g. std::string_view for std::string,
+    // and out has append(const void *, std::size_t).
+    template <typename C, typename = void>
+    struct conditionCodec {};
+    // Integers, enums and types whose equal values have equal bytes (not floating point, -0.0 == 0.0).
+    template <typename C>
+    struct conditionCodec<C, std::enable_if_t<std::is_integral_v<C> || std::is_enum_v<C> ||
+                                              (std::has_unique_object_representations_v<C> && !std::is_pointer_v<C>)>> {
+        template <typename Out>
+        static inline void encode(const C &c, Out &out) noexcept(noexcept(out.append(nullptr, 0))) {
+            out.append(std::addressof(c), sizeof(C));
+        }
+    };
+    template <typename Ch, typename Tr, typename Al>
+    struct conditionCodec<std::basic_string<Ch, Tr, Al>> {
+        template <typename A, typename Out>
+        static inline void encode(const A &a, Out &out) noexcept(noexcept(out.append(nullptr, 0))) {
+            std::basic_string_view<Ch, Tr> v(a);
+            std::uint32_t n = static_cast<std::uint32_t>(v.size());
+            out.append(&n, sizeof(n));
+            out.append(v.data(), v.size() * sizeof(Ch));
+        }
+    };
+
+    template <typename Key, typename Q, typename Out, std::size_t... I>
+    inline void conditionBytes(const Q &q, Out &out, std::index_sequence<I...>) {
+        (conditionCodec<std::tuple_element_t<I, Key>>::encode(std::get<I>(q), out), ...);
+    }
+    // The bytes of a condition tuple, or of a tuple of borrowed arguments (the same as the equal conditions).
+    template <typename Key, typename Q, typename Out>
+    inline void conditionBytes(const Q &q, Out &out) noexcept(noexcept(out.append(nullptr, 0))) {
+        conditionBytes<Key>(q, out, std::make_index_sequence<std::tuple_size_v<Key>>{});
+    }
+
+    // Called by the registries once the lock is taken.
+    struct noProbe {
+        inline void operator()() const noexcept {}
+    };
+
+    // What two cores should not write on together (false sharing): the lock words, shards, wait buckets and the
+    // registry state of each type are aligned and padded to it.
+#if defined(__cpp_lib_hardware_interference_size) && !defined(__GNUC__)
+    inline constexpr std::size_t cacheLine = std::hardware_destructive_interference_size;
+#else
+    // GCC warns that its value follows -mtune (it would differ between translation units), 64 is the line of x86-64
+    // and most ARM cores.
+    inline constexpr std::size_t cacheLine = 64;
+#endif
+    // Define ONE_NO_PADDING to pack them instead, e.g. to measure what the padding buys (bench/one_bench.cpp) or to
+    // save the memory on a single core.
+#if defined(ONE_NO_PADDING)
+    inline constexpr bool padding = false;
+#else
+    inline constexpr bool padding = true;
+#endif
+    // The alignment of a padded T, its own without padding.
+    template <typename T>
+    inline constexpr std::size_t lineOf = padding && alignof(T) < cacheLine ? cacheLine : alignof(T);
+    // T on cache lines of its own. Empty policies (no stats, no pool) stay empty.
+    template <typename T>
+    struct alignas(cacheLine) cacheAligned : T {
+        using T::T;
+    };
+    template <typename T>
+    using padded = std::conditional_t<!padding || std::is_empty_v<T>, T, cacheAligned<T>>;
+
+    // Runs make() once for everyone asking, the others asking meanwhile wait for it (the lazy object of one, the instance
+    // of sharedRef). Not std::call_once: with libstdc++ the callers after a throwing make() can deadlock.
+    class onceStage {
+    private:
+        enum : std::uint8_t { pending, building, built };
+        std::atomic<std::uint8_t> stage{pending};
+
+    public:
+        // If make() throws, the exception is passed to its caller; then the next one asking runs make() again if retry,
+        // otherwise it is done.
+        template <typename Make>
+        inline void run(Make &&make, bool retry) {
+            std::uint8_t st = stage.load(std::memory_order_acquire);
+            while (st != built) {
+                if (st == pending && stage.compare_exchange_strong(st, building, std::memory_order_acquire)) {
+                    try {
+                        make();
+                    } catch (...) {
+                        stage.store(retry ? pending : built, std::memory_order_release);
+                        stage.notify_all();
+                        throw;
+                    }
+                    stage.store(built, std::memory_order_release);
+                    stage.notify_all();
+                    return;
+                }
+                if (st == building) {
+                    stage.wait(building, std::memory_order_acquire);
+                    st = stage.load(std::memory_order_acquire);
+                }
+            }
+        }
+    };
+
+    // allocator policies of the registry nodes, choose one through oneTraits<T, Conditions...>::allocator
+    // The global operator new, the default.
+    struct heapAllocator {
+        static inline void *allocate(std::size_t n) {
+            return ::operator new(n);
+        }
+        static inline void deallocate(void *p, std::size_t n) noexcept {
+            ::operator delete(p, n);
+        }
+    };
+    // Blocks in size classes of 16 bytes (up to 512, larger ones go to operator new), in a free list per thread.
+    // The lists are refilled from 16 KiB slabs, and trade blocks with a shared list in batches (a thread that frees more
+    // than it allocates, or exits), so in steady state acquire and release do not call the global allocator.
+    // Slabs are never returned to the system.
+    class poolAllocator {
+    private:
+        struct block {
+            block *next;
+        };
+        struct list {
+            block *head = nullptr;
+            std::size_t count = 0;
+        };
+        static constexpr std::size_t granularity = 16, classes = 33, slabBytes = 16 * 1024, batch = 32;
+        struct depot {
+            std::mutex lock;
+            list lists[classes];
+        };
+        struct cache {
+            list lists[classes];
+            // The thread is exiting (or the program, for the main thread) and this has been handed to the depot.
+            bool gone = false;
+        };
+        struct flusher {
+            ~flusher() {
+                cache &c = local();
+                depot &d = shared();
+                std::lock_guard<std::mutex> guard(d.lock);
+                for (std::size_t i = 0; i < classes; ++i)
+                    while (c.lists[i].head)
+                        push(d.lists[i], pop(c.lists[i]));
+                c.gone = true;
+            }
+        };
+
+        // Never destroyed, the registries are static too and still free their nodes during static destruction.
+        static inline depot &shared() noexcept {
+            static depot *d = new depot;
+            return *d;
+        }
+        static inline cache &local() noexcept {
+            thread_local cache c;
+            thread_local flusher f;
+            return c;
+        }
+        static inline void push(list &l, void *p) noexcept {
+            block *b = static_cast<block *>(p);
+            b->next = l.head;
+            l.head = b;
+            ++l.count;
+        }
+        static inline void *pop(list &l) noexcept {
+            block *b = l.head;
+            l.head = b->next;
+            --l.count;
+            return b;
+        }
+        // The caller holds the lock of the depot.
+        static inline void carve(list &l, std::size_t i) {
+            std::size_t size = i * granularity, n = slabBytes / size;
+            char *slab = static_cast<char *>(::operator new(n * size));
+            while (n)
+                push(l, slab + --n * size);
+        }
+        static inline void *takeShared(std::size_t i, list *into) {
+            depot &d = shared();
+            std::lock_guard<std::mutex> guard(d.lock);
+            list &s = d.lists[i];
+            if (!s.head)
+                carve(s, i);
+            if (into)
+                while (into->count < batch && s.head)
+                    push(*into, pop(s));
+            return into ? pop(*into) : pop(s);
+        }
+
+    public:
+        static inline void *allocate(std::size_t n) {
+            std::size_t i = (n + granularity - 1) / granularity;
+            if (i >= classes)
+                return ::operator new(n);
+            cache &c = local();
+            if (c.gone)
+                return takeShared(i, nullptr);
+            list &l = c.lists[i];
+            return l.head ? pop(l) : takeShared(i, &l);
+        }
+        static inline void deallocate(void *p, std::size_t n) noexcept {
+            std::size_t i = (n + granularity - 1) / granularity;
+            if (i >= classes)
+                return ::operator delete(p, n);
+            cache &c = local();
+            list &l = c.lists[i];
+            if (!c.gone) {
+                push(l, p);
+                if (l.count <= 2 * batch)
+                    return;
+            }
+            depot &d = shared();
+            std::lock_guard<std::mutex> guard(d.lock);
+            if (c.gone)
+                push(d.lists[i], p);
+            else
+                while (l.count > batch)
+                    push(d.lists[i], pop(l));
+        }
+    };
+
+    // Base of the nodes, new and delete of them go to Alloc. Over-aligned nodes still use the global operator new.
+    template <typename Alloc>
+    struct allocatedBy {
+        static inline void *operator new(std::size_t n) {
+            return Alloc::allocate(n);
+        }
+        static inline void operator delete(void *p, std::size_t n) noexcept {
+            Alloc::deallocate(p, n);
+        }
+        static inline void *operator new(std::size_t n, std::align_val_t a) {
+            return ::operator new(n, a);
+        }
+        static inline void operator delete(void *p, std::size_t n, std::align_val_t a) noexcept {
+            ::operator delete(p, n, a);
+        }
+    };
+
+    // The original list, linear find. Only needs operator ==.
+    // If the conditions have a hash, it is kept in an array next to the list: a find scans the hashes, and only
+    // touches the nodes whose hash is equal (none with an exact hash, see tupleHash).
+    // The lookups take anything comparable with Key (e.g. a tuple of borrowed arguments), Key is made only on insert.
+    // Every condition has a node of its own, its handle stays valid until it is extracted.
+    template <typename Key, typename Alloc = heapAllocator>
+    class vectorStorage {
+    private:
+        static constexpr bool hashed = isKeyHashable<Key>;
+        struct node : allocatedBy<Alloc> {
+            Key key;
+            std::size_t index;
+            // Holders of a shared condition (oneShared), 0 if it is held exclusively.
+            std::size_t shares = 0;
+            // What the holders share through the node (the instance of sharedGet), writer only.
+            void *payload = nullptr;
+        };
+        std::vector<node *> list;
+        // hashes[i] is the hash of list[i], empty if not hashed.
+        std::vector<std::size_t> hashes;
+
+        template <typename Q>
+        inline node *find(const Q &k) const noexcept {
+            if constexpr (hashed) {
+                std::size_t h = tupleHash<Key>{}(k);
+                for (std::size_t i = 0; i < hashes.size(); ++i)
+                    if (hashes[i] == h && (isExactHash<tupleHash<Key>> || list[i]->key == k))
+                        return list[i];
+            } else
+                for (node *n : list)
+                    if (n->key == k)
+                        return n;
+            return nullptr;
+        }
+
+    public:
+        using handle = node *;
+        using extracted = std::unique_ptr<node>;
+
+        vectorStorage() = default;
+        vectorStorage(const vectorStorage &) = delete;
+        vectorStorage &operator=(const vectorStorage &) = delete;
+        ~vectorStorage() {
+            for (node *n : list)
+                delete n;
+        }
+
+        static inline const Key &key(handle h) noexcept {
+            return h->key;
+        }
+        static inline std::size_t &shares(handle h) noexcept {
+            return h->shares;
+        }
+        static inline void *&payload(handle h) noexcept {
+            return h->payload;
+        }
+        // The node of k, or nullptr.
+        template <typename Q>
+        inline handle lookup(const Q &k) const noexcept {
+            return find(k);
+        }
+        template <typename Q>
+        inline bool contains(const Q &k) const noexcept {
+            return find(k) != nullptr;
+        }
+        template <typename Q>
+        inline handle insert(Q &&k) {
+            std::unique_ptr<node> n(new node{{}, Key(std::forward<Q>(k)), list.size()});
+            if constexpr (hashed) {
+                hashes.push_back(tupleHash<Key>{}(n->key));
+                try {
+                    list.push_back(n.get());
+                } catch (...) {
+                    hashes.pop_back();
+                    throw;
+                }
+            } else
+                list.push_back(n.get());
+            return n.release();
+        }
+        // Insert if not exists, ret nullptr if there is the same.
+        template <typename Q>
+        inline handle tryInsert(Q &&k) {
+            if (find(k))
+                return nullptr;
+            return insert(std::forward<Q>(k));
+        }
+        // Unlink the node of h without a lookup, the last node takes its place. It is freed with the returned pointer.
+        inline extracted extract(handle h) noexcept {
+            node *last = list.back();
+            list[h->index] = last;
+            last->index = h->index;
+            list.pop_back();
+            if constexpr (hashed) {
+                hashes[h->index] = hashes.back();
+                hashes.pop_back();
+            }
+            return extracted(h);
+        }
+        template <typename Q>
+        inline bool erase(const Q &k) noexcept {
+            node *n = find(k);
+            if (n)
+                extract(n);
+            return n;
+        }
+        inline std::size_t size() const noexcept {
+            return list.size();
+        }
+    };
+
+    // Chained hash table, the hash is stored next to each condition so mismatches are rejected before operator ==
+    // (and operator == is not called at all with an exact hash, see tupleHash).
+    // Lookup, insert and erase are O(1) on average, extracting a handle is O(1).
+    template <typename Key, typename Hash = tupleHash<Key>, typename Alloc = heapAllocator>
+    class hashStorage {
+    private:
+        struct node : allocatedBy<Alloc> {
+            node *next;
+            // The pointer that points to this node (the bucket or next of the previous node).
+            node **prev;
+            std::size_t hash;
+            Key key;
+            // Holders of a shared condition (oneShared), 0 if it is held exclusively.
+            std::size_t shares = 0;
+            // What the holders share through the node (the instance of sharedGet), writer only.
+            void *payload = nullptr;
+        };
+        std::vector<node *> buckets;
+        std::size_t count = 0;
+
+        inline node **slot(std::size_t h) noexcept {
+            return &buckets[h & (buckets.size() - 1)];
+        }
+        template <typename Q>
+        inline node *const *find(const Q &k, std::size_t h) const noexcept {
+            if (buckets.empty())
+                return nullptr;
+            node *const *p = &buckets[h & (buckets.size() - 1)];
+            for (; *p; p = &(*p)->next)
+                if ((*p)->hash == h && (isExactHash<Hash> || (*p)->key == k))
+                    return p;
+            return nullptr;
+        }
+        inline void link(node *n, node **s) noexcept {
+            n->next = *s;
+            n->prev = s;
+            if (*s)
+                (*s)->prev = &n->next;
+            *s = n;
+        }
+        inline void unlink(node *n) noexcept {
+            *n->prev = n->next;
+            if (n->next)
+                n->next->prev = n->prev;
+            --count;
+        }
+        inline void rehash(std::size_t n) {
+            std::vector<node *> old(n, nullptr);
+            old.swap(buckets);
+            for (node *b : old)
+                while (b) {
+                    node *next = b->next;
+                    link(b, slot(b->hash));
+                    b = next;
+                }
+        }
+
+    public:
+        using handle = node *;
+        using extracted = std::unique_ptr<node>;
+
+        hashStorage() = default;
+        hashStorage(const hashStorage &) = delete;
+        hashStorage &operator=(const hashStorage &) = delete;
+        ~hashStorage() {
+            for (node *b : buckets)
+                while (b) {
+                    node *next = b->next;
+                    delete b;
+                    b = next;
+                }
+        }
+
+        static inline const Key &key(handle h) noexcept {
+            return h->key;
+        }
+        static inline std::size_t hash(handle h) noexcept {
+            return h->hash;
+        }
+        static inline std::size_t &shares(handle h) noexcept {
+            return h->shares;
+        }
+        static inline void *&payload(handle h) noexcept {
+            return h->payload;
+        }
+        // The node of k, or nullptr.
+        template <typename Q>
+        inline handle lookup(const Q &k) const noexcept {
+            return lookup(k, Hash{}(k));
+        }
+        template <typename Q>
+        inline handle lookup(const Q &k, std::size_t h) const noexcept {
+            node *const *p = find(k, h);
+            return p ? *p : nullptr;
+        }
+        // Lookups by anything Hash and == accept (e.g. a tuple of borrowed arguments), h is its hash.
+        template <typename Q>
+        inline bool contains(const Q &k) const noexcept {
+            return contains(k, Hash{}(k));
+        }
+        template <typename Q>
+        inline bool contains(const Q &k, std::size_t h) const noexcept {
+            return find(k, h) != nullptr;
+        }
+        template <typename Q>
+        inline handle insert(Q &&k) {
+            std::size_t h = Hash{}(k);
+            return insert(std::forward<Q>(k), h);
+        }
+        template <typename Q>
+        inline handle insert(Q &&k, std::size_t h) {
+            if (count >= buckets.size())
+                rehash(buckets.empty() ? 16 : buckets.size() * 2);
+            node *n = new node{{}, nullptr, nullptr, h, Key(std::forward<Q>(k))};
+            link(n, slot(h));
+            ++count;
+            return n;
+        }
+        // Insert if not exists, ret nullptr if there is the same. Key is made from k only if inserted.
+        template <typename Q>
+        inline handle tryInsert(Q &&k) {
+            std::size_t h = Hash{}(k);
+            return tryInsert(std::forward<Q>(k), h);
+        }
+        template <typename Q>
+        inline handle tryInsert(Q &&k, std::size_t h) {
+            if (find(k, h))
+                return nullptr;
+            return insert(std::forward<Q>(k), h);
+        }
+        // Unlink the node of h, no lookup and no walk of its bucket. It is freed with the returned pointer.
+        inline extracted extract(handle h) noexcept {
+            unlink(h);
+            return extracted(h);
+        }
+        template <typename Q>
+        inline bool erase(const Q &k) noexcept {
+            return erase(k, Hash{}(k));
+        }
+        // ret false if not found.
+        template <typename Q>
+        inline bool erase(const Q &k, std::size_t h) noexcept {
+            node *const *p = find(k, h);
+            if (!p)
+                return false;
+            node *n = *p;
+            unlink(n);
+            delete n;
+            return true;
+        }
+        inline std::size_t size() const noexcept {
+            return count;
+        }
+    };
+
+    // lock policies, choose one through oneTraits<T, Conditions...>::lock
+    // std::timed_mutex is the default, or adaptiveMutex. A lock policy is a TimedLockable type.
+
+    // Waits a few cycles without giving up the core (a pause hint to the CPU).
+    inline void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#else
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    // For critical sections of a few instructions (a lookup and a push): a contended lock() first spins, with
+    // exponential backoff, for about as long as it took to get the lock the last times (adapted per lock, at most
+    // maxSpins checks), and only then parks the thread on a futex (std::atomic::wait without a time out, or
+    // sleeps of at most a millisecond elsewhere), so the time outs of try_lock_for are still honored.
+    // unlock() makes a system call only if a thread is parked.
+    class adaptiveMutex {
+    private:
+        static constexpr std::uint32_t maxSpins = 128;
+        // 0 unlocked, 1 locked, 2 locked and maybe parked threads
+        std::atomic<std::uint32_t> state{0};
+        // Average spins it took to get the lock.
+        std::atomic<std::uint32_t> spins{0};
+
+        // Wait while state is 2, until woken, the deadline (if there is one) or spuriously.
+        inline void park(const std::chrono::steady_clock::time_point *deadline) noexcept {
+#if defined(__linux__)
+            timespec ts, *left = nullptr;
+            if (deadline) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*deadline - std::chrono::steady_clock::now()).count();
+                if (ns <= 0)
+                    return;
+                ts.tv_sec = static_cast<decltype(ts.tv_sec)>(ns / 1000000000);
+                ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>(ns % 1000000000);
+                left = &ts;
+            }
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&state), FUTEX_WAIT_PRIVATE, 2u, left, nullptr, 0);
+#else
+            if (!deadline) {
+                state.wait(2, std::memory_order_relaxed);
+                return;
+            }
+            auto left = *deadline - std::chrono::steady_clock::now();
+            if (left > std::chrono::steady_clock::duration::zero())
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(left, std::chrono::milliseconds(1)));
+#endif
+        }
+        inline void wakeOne() noexcept {
+#if defined(__linux__)
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+            state.notify_one();
+#endif
+        }
+        inline bool lockSlow(const std::chrono::steady_clock::time_point *deadline) noexcept {
+            std::uint32_t average = spins.load(std::memory_order_relaxed);
+            std::uint32_t limit = std::min(maxSpins, average * 2 + 16);
+            std::uint32_t n = 0;
+            for (std::uint32_t backoff = 1; n < limit; ++n, backoff = std::min<std::uint32_t>(backoff * 2, 64)) {
+                if (state.load(std::memory_order_relaxed) == 0 && try_lock()) {
+                    spins.store(average + (static_cast<std::int32_t>(n - average) / 8), std::memory_order_relaxed);
+                    return true;
+                }
+                for (std::uint32_t i = 0; i < backoff; ++i)
+                    cpuRelax();
+            }
+            spins.store(average + (static_cast<std::int32_t>(limit - average) / 8), std::memory_order_relaxed);
+            while (state.exchange(2, std::memory_order_acquire) != 0) {
+                if (deadline && std::chrono::steady_clock::now() >= *deadline)
+                    return false;
+                park(deadline);
+            }
+            return true;
+        }
+
+    public:
+        adaptiveMutex() noexcept = default;
+        adaptiveMutex(const adaptiveMutex &) = delete;
+        adaptiveMutex &operator=(const adaptiveMutex &) = delete;
+
+        inline bool try_lock() noexcept {
+            std::uint32_t unlocked = 0;
+            return state.compare_exchange_strong(unlocked, 1, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+        inline void lock() noexcept {
+            if (!try_lock())
+                lockSlow(nullptr);
+        }
+        template <typename Clock, typename Duration>
+        inline bool try_lock_until(const std::chrono::time_point<Clock, Duration> &t) noexcept {
+            if (try_lock())
+                return true;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(t - Clock::now());
+            return lockSlow(&deadline);
+        }
+        template <typename Rep, typename Period>
+        inline bool try_lock_for(const std::chrono::duration<Rep, Period> &d) noexcept {
+            if (try_lock())
+                return true;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(d);
+            return lockSlow(&deadline);
+        }
+        inline void unlock() noexcept {
+            if (state.exchange(0, std::memory_order_release) == 2)
+                wakeOne();
+        }
+    };
+
+    // One lock for the whole storage.
+    template <typename Storage, typename Lock = std::timed_mutex>
+    class lockedStorage {
+    private:
+        Lock lock;
+        Storage table;
+
+    public:
+        using handle = typename Storage::handle;
+        using extracted = typename Storage::extracted;
+
+        static inline decltype(auto) key(handle h) noexcept {
+            return Storage::key(h);
+        }
+        static inline std::size_t &shares(handle h) noexcept {
+            return Storage::shares(h);
+        }
+        static inline void *&payload(handle h) noexcept {
+            return Storage::payload(h);
+        }
+        // The caller holds lockFor(k).
+        template <typename Key>
+        inline handle lookup(const Key &k) const noexcept {
+            return table.lookup(k);
+        }
+        // Of a condition or a handle, it is the same lock.
+        template <typename Key>
+        inline Lock &lockFor(const Key &) noexcept {
+            return lock;
+        }
+        template <typename Key>
+        inline bool contains(const Key &k) const noexcept {
+            return table.contains(k);
+        }
+        template <typename Key>
+        inline handle insert(Key &&k) {
+            return table.insert(std::forward<Key>(k));
+        }
+        template <typename Key>
+        inline bool erase(const Key &k) noexcept {
+            return table.erase(k);
+        }
+        // The caller holds lockFor(h).
+        inline extracted extract(handle h) noexcept {
+            return table.extract(h);
+        }
+        // Lookup and insert in a single pass while holding the lock, h is the inserted node. probe() is called once the lock is taken.
+        template <typename Key, typename Probe = noProbe>
+        inline status tryEmplace(Key &&k, const std::chrono::milliseconds &t, handle &h, Probe &&probe = Probe{}) {
+            if (!lock.try_lock_for(t))
+                return status::timeOut;
+            probe();
+            h = table.tryInsert(std::forward<Key>(k));
+            lock.unlock();
+            return h ? status::ok : status::same;
+        }
+        inline std::size_t size() const noexcept {
+            return table.size();
+        }
+    };
+
+    // Shards chosen by the hash of the condition, each one has its own lock and table.
+    // Different conditions almost never contend.
+    template <typename Key, std::size_t Shards, typename Hash = tupleHash<Key>, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+    class shardedStorage {
+        static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "Shards should be a power of two");
+
+    private:
+        using tableType = hashStorage<Key, Hash, Alloc>;
+        // A lock and its table per line, shards locked by different cores do not share one.
+        struct shard {
+            alignas(lineOf<Lock>) Lock lock;
+            tableType table;
+        };
+        shard shards[Shards];
+
+        // The table uses the low bits of the hash, so pick the shard from the high bits (fibonacci hashing).
+        static inline std::size_t index(std::size_t h) noexcept {
+            if constexpr (Shards == 1)
+                return 0;
+            else
+                return (h * static_cast<std::size_t>(0x9e3779b97f4a7c15ULL)) >> (sizeof(std::size_t) * 8 - std::countr_zero(Shards));
+        }
+
+    public:
+        using handle = typename tableType::handle;
+        using extracted = typename tableType::extracted;
+
+        static inline const Key &key(handle h) noexcept {
+            return tableType::key(h);
+        }
+        static inline std::size_t &shares(handle h) noexcept {
+            return tableType::shares(h);
+        }
+        static inline void *&payload(handle h) noexcept {
+            return tableType::payload(h);
+        }
+        // The caller holds lockFor(k).
+        template <typename Q>
+        inline handle lookup(const Q &k) const noexcept {
+            std::size_t h = Hash{}(k);
+            return shards[index(h)].table.lookup(k, h);
+        }
+        // The node keeps the hash, no need to hash the conditions again.
+        inline Lock &lockFor(handle h) noexcept {
+            return shards[index(tableType::hash(h))].lock;
+        }
+        template <typename Q>
+        inline Lock &lockFor(const Q &k) noexcept {
+            return shards[index(Hash{}(k))].lock;
+        }
+        template <typename Q>
+        inline bool contains(const Q &k) const noexcept {
+            std::size_t h = Hash{}(k);
+            return shards[index(h)].table.contains(k, h);
+        }
+        template <typename Q>
+        inline handle insert(Q &&k) {
+            std::size_t h = Hash{}(k);
+            return shards[index(h)].table.insert(std::forward<Q>(k), h);
+        }
+        template <typename Q>
+        inline bool erase(const Q &k) noexcept {
+            std::size_t h = Hash{}(k);
+            return shards[index(h)].table.erase(k, h);
+        }
+        // The caller holds lockFor(h).
+        inline extracted extract(handle h) noexcept {
+            return shards[index(tableType::hash(h))].table.extract(h);
+        }
+        // Lookup and insert in a single pass while holding the lock of the shard, h is the inserted node.
+        template <typename Q, typename Probe = noProbe>
+        inline status tryEmplace(Q &&k, const std::chrono::milliseconds &t, handle &out, Probe &&probe = Probe{}) {
+            std::size_t h = Hash{}(k);
+            shard &s = shards[index(h)];
+            if (!s.lock.try_lock_for(t))
+                return status::timeOut;
+            probe();
+            out = s.table.tryInsert(std::forward<Q>(k), h);
+            s.lock.unlock();
+            return out ? status::ok : status::same;
+        }
+        // Not locked, only approximate while other threads are working.
+        inline std::size_t size() const noexcept {
+            std::size_t n = 0;
+            for (const shard &s : shards)
+                n += s.table.size();
+            return n;
+        }
+    };
+
+    // Readers (contains, that is verified) take no lock and never block add or erase, the writers still share one lock.
+    // Erased nodes are reclaimed by epoch: a node is freed only after every reader that could have seen it has left.
+    template <typename Key, typename Hash = tupleHash<Key>, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+    class lockFreeStorage {
+    private:
+        struct entry;
+        // The conditions, it keeps its address while the table grows.
+        struct node : allocatedBy<Alloc> {
+            std::size_t hash;
+            Key key;
+            // Its entry in the current table, writer only.
+            entry *at = nullptr;
+            // Holders of a shared condition (oneShared), writer only, 0 if it is held exclusively.
+            std::size_t shares = 0;
+            // What the holders share through the node (the instance of sharedGet), writer only.
+            void *payload = nullptr;
+        };
+        // A link of a bucket, a grown table gets copies of these (not of the conditions).
+        struct entry : allocatedBy<Alloc> {
+            std::atomic<entry *> next;
+            std::size_t hash;
+            node *n;
+            // The pointer that points to this entry, writer only (readers only follow next).
+            std::atomic<entry *> *prev = nullptr;
+        };
+        struct table {
+            std::size_t mask;
+            std::unique_ptr<std::atomic<entry *>[]> buckets;
+            explicit table(std::size_t n) : mask(n - 1), buckets(new std::atomic<entry *>[n]()) {}
+            // The entries only, the nodes may be linked in the next table too.
+            ~table() {
+                for (std::size_t i = 0; i <= mask; ++i)
+                    for (entry *b = buckets[i].load(std::memory_order_relaxed); b;) {
+                        entry *next = b->next.load(std::memory_order_relaxed);
+                        delete b;
+                        b = next;
+                    }
+            }
+        };
+
+        // The writers' lock apart from what the readers load.
+        alignas(lineOf<Lock>) Lock lock;
+        alignas(lineOf<std::atomic<table *>>) std::atomic<table *> current{nullptr};
+        std::atomic<std::size_t> count{0};
+        // Readers announce themselves in the counter of the epoch parity they entered.
+        std::atomic<std::size_t> epoch{0};
+        alignas(lineOf<std::atomic<std::size_t>>) std::atomic<std::size_t> active[2] = {};
+        // Retired in an epoch, only touched by the writers.
+        std::vector<node *> limboNodes[2];
+        std::vector<entry *> limboEntries[2];
+        std::vector<table *> limboTables[2];
+
+        inline std::size_t enter() const noexcept {
+            auto *self = const_cast<lockFreeStorage *>(this);
+            for (;;) {
+                std::size_t e = epoch.load() & 1;
+                self->active[e].fetch_add(1);
+                // Validate, an advance in between may already have freed what this reader is about to see.
+                if ((epoch.load() & 1) == e)
+                    return e;
+                self->active[e].fetch_sub(1);
+            }
+        }
+        inline void leave(std::size_t e) const noexcept {
+            const_cast<lockFreeStorage *>(this)->active[e].fetch_sub(1);
+        }
+        // Writer only. Once no reader of the previous epoch is left, free what was retired in it and advance.
+        inline void reclaim() noexcept {
+            std::size_t e = epoch.load(std::memory_order_relaxed);
+            std::size_t old = (e + 1) & 1;
+            if (active[old].load() != 0)
+                return;
+            for (node *n : limboNodes[old])
+                delete n;
+            for (entry *n : limboEntries[old])
+                delete n;
+            for (table *t : limboTables[old])
+                delete t;
+            limboNodes[old].clear();
+            limboEntries[old].clear();
+            limboTables[old].clear();
+            epoch.store(e + 1);
+        }
+        inline std::size_t retiring() const noexcept {
+            return epoch.load(std::memory_order_relaxed) & 1;
+        }
+        // Writer only. Make e the head of b, it is published with order (release once it is ready for the readers).
+        static inline void link(entry *e, std::atomic<entry *> &b, std::memory_order order) noexcept {
+            entry *head = b.load(std::memory_order_relaxed);
+            e->next.store(head, std::memory_order_relaxed);
+            e->prev = &b;
+            e->n->at = e;
+            if (head)
+                head->prev = &e->next;
+            b.store(e, order);
         }
+        template <typename Q>
+        inline entry *find(const table *t, const Q &k, std::size_t h) const noexcept {
+            for (entry *n = t->buckets[h & t->mask].load(std::memory_order_acquire); n; n = n->next.load(std::memory_order_acquire))
+                if (n->hash == h && (isExactHash<Hash> || n->n->key == k))
+                    return n;
+            return nullptr;
+        }
+        // Writer only. The old table keeps its entries for the readers still walking it, the new one gets copies.
+        inline table *grow(table *old) {
+            table *t = new table(old ? (old->mask + 1) * 2 : 16);
+            if (old) {
+                for (std::size_t i = 0; i <= old->mask; ++i)
+                    for (entry *n = old->buckets[i].load(std::memory_order_relaxed); n; n = n->next.load(std::memory_order_relaxed))
+                        link(new entry{{}, nullptr, n->hash, n->n}, t->buckets[n->hash & t->mask], std::memory_order_relaxed);
+                limboTables[retiring()].push_back(old);
+            }
+            current.store(t, std::memory_order_release);
+            return t;
+        }
+        template <typename Q>
+        inline node *insertLocked(Q &&k, std::size_t h) {
+            table *t = current.load(std::memory_order_relaxed);
+            if (t && find(t, k, h))
+                return nullptr;
+            if (!t || count.load(std::memory_order_relaxed) > t->mask)
+                t = grow(t);
+            std::unique_ptr<node> n(new node{{}, h, Key(std::forward<Q>(k))});
+            link(new entry{{}, nullptr, h, n.get()}, t->buckets[h & t->mask], std::memory_order_release);
+            count.fetch_add(1, std::memory_order_relaxed);
+            reclaim();
+            return n.release();
+        }
+        // Writer only. Unlink the entry of n from the current table in O(1), readers standing on it can still follow its next.
+        inline void unlinkLocked(node *n) noexcept {
+            entry *e = n->at;
+            entry *next = e->next.load(std::memory_order_relaxed);
+            if (next)
+                next->prev = e->prev;
+            e->prev->store(next, std::memory_order_release);
+            limboEntries[retiring()].push_back(e);
+            limboNodes[retiring()].push_back(n);
+            count.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+    public:
+        using handle = node *;
+        // contains does not need lockFor, a held condition is seen by a lookup alone.
+        static constexpr bool lockFreeContains = true;
+        // An extracted node stays readable until this is dropped, then it is reclaimed like any erased node.
+        class extracted {
+        private:
+            const lockFreeStorage *s;
+            std::size_t e;
+            node *n;
+
+        public:
+            extracted(const lockFreeStorage *s, std::size_t e, node *n) noexcept : s(s), e(e), n(n) {}
+            extracted(extracted &&o) noexcept : s(std::exchange(o.s, nullptr)), e(o.e), n(o.n) {}
+            extracted &operator=(extracted &&) = delete;
+            ~extracted() {
+                if (s)
+                    s->leave(e);
+            }
+            inline node *operator->() const noexcept {
+                return n;
+            }
+        };
+
+        lockFreeStorage() = default;
+        lockFreeStorage(const lockFreeStorage &) = delete;
+        lockFreeStorage &operator=(const lockFreeStorage &) = delete;
+        ~lockFreeStorage() {
+            for (int i = 0; i < 2; ++i) {
+                for (node *n : limboNodes[i])
+                    delete n;
+                for (entry *n : limboEntries[i])
+                    delete n;
+                for (table *t : limboTables[i])
+                    delete t;
+            }
+            if (table *t = current.load(std::memory_order_relaxed)) {
+                for (std::size_t i = 0; i <= t->mask; ++i)
+                    for (entry *n = t->buckets[i].load(std::memory_order_relaxed); n; n = n->next.load(std::memory_order_relaxed))
+                        delete n->n;
+                delete t;
+            }
+        }
+
+        static inline const Key &key(handle h) noexcept {
+            return h->key;
+        }
+        static inline std::size_t &shares(handle h) noexcept {
+            return h->shares;
+        }
+        static inline void *&payload(handle h) noexcept {
+            return h->payload;
+        }
+        // The caller holds lockFor(k).
+        template <typename Q>
+        inline handle lookup(const Q &k) const noexcept {
+            table *t = current.load(std::memory_order_relaxed);
+            entry *e = t ? find(t, k, Hash{}(k)) : nullptr;
+            return e ? e->n : nullptr;
+        }
+        // The lock of the writers, readers do not need it.
+        template <typename Q>
+        inline Lock &lockFor(const Q &) noexcept {
+            return lock;
+        }
+        template <typename Q>
+        inline bool contains(const Q &k) const noexcept {
+            std::size_t h = Hash{}(k);
+            std::size_t e = enter();
+            table *t = current.load(std::memory_order_acquire);
+            bool found = t && find(t, k, h);
+            leave(e);
+            return found;
+        }
+        // The caller holds lockFor(k).
+        template <typename Q>
+        inline handle insert(Q &&k) {
+            std::size_t h = Hash{}(k);
+            return insertLocked(std::forward<Q>(k), h);
+        }
+        template <typename Q>
+        inline bool erase(const Q &k) noexcept {
+            std::size_t h = Hash{}(k);
+            table *t = current.load(std::memory_order_relaxed);
+            entry *n = t ? find(t, k, h) : nullptr;
+            if (n)
+                unlinkLocked(n->n);
+            reclaim();
+            return n;
+        }
+        // The caller holds lockFor(h). It enters the epoch itself before retiring the node, so the node outlives the lock.
+        inline extracted extract(handle h) noexcept {
+            std::size_t e = enter();
+            unlinkLocked(h);
+            reclaim();
+            return extracted(this, e, h);
+        }
+        template <typename Q, typename Probe = noProbe>
+        inline status tryEmplace(Q &&k, const std::chrono::milliseconds &t, handle &out, Probe &&probe = Probe{}) {
+            std::size_t h = Hash{}(k);
+            if (!lock.try_lock_for(t))
+                return status::timeOut;
+            probe();
+            out = insertLocked(std::forward<Q>(k), h);
+            lock.unlock();
+            return out ? status::ok : status::same;
+        }
+        inline std::size_t size() const noexcept {
+            return count.load(std::memory_order_relaxed);
+        }
+    };
+
+    // A bit per value of a single bounded condition. Exclusive holders acquire and release with one atomic operation on
+    // their bit, without the lock and even without lockFor (lockFreeExtract); shared holders and waiters still take the lock.
+    // The nodes come in pages of 64 values, a page is allocated by the first acquire of one of its values and kept until
+    // the registry goes: the memory is a bit and a pointer / 64 per value, and the pages of the values used.
+    template <typename Key, typename Lock = std::timed_mutex>
+    class boundedStorage;
+    template <auto Lo, auto Hi, typename Lock>
+    class boundedStorage<std::tuple<bounded<Lo, Hi>>, Lock> {
+    private:
+        using Key = std::tuple<bounded<Lo, Hi>>;
+        static constexpr std::size_t count = bounded<Lo, Hi>::count;
+        struct node {
+            Key key;
+            // Holders of a shared condition (oneShared), 0 if it is held exclusively.
+            std::size_t shares = 0;
+            // What the holders share through the node (the instance of sharedGet), writer only.
+            void *payload = nullptr;
+        };
+        // The nodes of the values of a bit word.
+        struct page {
+            node nodes[64];
+            // The values from first on, the last page is filled up with the last value.
+            template <std::size_t... J>
+            page(std::size_t first, std::index_sequence<J...>) : nodes{node{Key(bounded<Lo, Hi>::at(std::min(first + J, count - 1)))}...} {}
+        };
+        Lock lock;
+        // seq_cst, a release sees the waiter that parked before it took the bit (see waitQueue::notify).
+        // Apart from the lock of the shared holders.
+        alignas(lineOf<std::atomic<std::uint64_t>>) std::atomic<std::uint64_t> bits[(count + 63) / 64] = {};
+        // Published before a bit of theirs is set, so a set bit has its page.
+        std::atomic<page *> pages[(count + 63) / 64] = {};
 
-        static bool verified(std::tuple<Conditions...> &&t) noexcept {
-            return (std::find(list.begin(), list.end(), t) != list.end());
+        template <typename Q>
+        static inline std::size_t indexOf(const Q &k) {
+            return bounded<Lo, Hi>(std::get<0>(k)).index();
+        }
+        static inline std::uint64_t bit(std::size_t i) noexcept {
+            return std::uint64_t(1) << (i & 63);
+        }
+        inline node *at(std::size_t i) const noexcept {
+            return pages[i / 64].load(std::memory_order_acquire)->nodes + (i & 63);
+        }
+        // The page of i, allocated if it is the first of its values.
+        inline node *make(std::size_t i) {
+            std::atomic<page *> &slot = pages[i / 64];
+            page *p = slot.load(std::memory_order_acquire);
+            if (!p) {
+                std::unique_ptr<page> fresh(new page(i / 64 * 64, std::make_index_sequence<64>{}));
+                if (slot.compare_exchange_strong(p, fresh.get(), std::memory_order_acq_rel))
+                    p = fresh.release();
+            }
+            return p->nodes + (i & 63);
+        }
+
+    public:
+        using handle = node *;
+        using extracted = node *;
+        // The release of an exclusive holder does not need lockFor.
+        static constexpr bool lockFreeExtract = true;
+        // A held condition is seen by loading its bit.
+        static constexpr bool lockFreeContains = true;
+
+        boundedStorage() noexcept {}
+        ~boundedStorage() {
+            for (auto &p : pages)
+                delete p.load(std::memory_order_relaxed);
+        }
+        boundedStorage(const boundedStorage &) = delete;
+        boundedStorage &operator=(const boundedStorage &) = delete;
+
+        static inline const Key &key(handle h) noexcept {
+            return h->key;
+        }
+        static inline std::size_t &shares(handle h) noexcept {
+            return h->shares;
+        }
+        static inline void *&payload(handle h) noexcept {
+            return h->payload;
+        }
+        template <typename Q>
+        inline handle lookup(const Q &k) const noexcept {
+            std::size_t i = indexOf(k);
+            return (bits[i / 64].load() & bit(i)) ? at(i) : nullptr;
+        }
+        // Of the shared holders and the waiters.
+        template <typename Q>
+        inline Lock &lockFor(const Q &) noexcept {
+            return lock;
+        }
+        template <typename Q>
+        inline bool contains(const Q &k) const noexcept {
+            std::size_t i = indexOf(k);
+            return (bits[i / 64].load() & bit(i)) != 0;
+        }
+        // Test and set, ret nullptr if it is held. It only throws if the page cannot be allocated.
+        template <typename Q>
+        inline handle insert(Q &&k) {
+            std::size_t i = indexOf(k);
+            node *n = make(i);
+            if (bits[i / 64].fetch_or(bit(i)) & bit(i))
+                return nullptr;
+            return n;
+        }
+        inline extracted extract(handle h) noexcept {
+            std::size_t i = indexOf(h->key);
+            bits[i / 64].fetch_and(~bit(i));
+            return h;
+        }
+        template <typename Q>
+        inline bool erase(const Q &k) noexcept {
+            std::size_t i = indexOf(k);
+            return bits[i / 64].fetch_and(~bit(i)) & bit(i);
+        }
+        // No lock, it never times out.
+        template <typename Q, typename Probe = noProbe>
+        inline status tryEmplace(Q &&k, const std::chrono::milliseconds &, handle &h, Probe &&probe = Probe{}) {
+            probe();
+            h = insert(std::forward<Q>(k));
+            return h ? status::ok : status::same;
+        }
+        inline std::size_t size() const noexcept {
+            std::size_t n = 0;
+            for (const auto &b : bits)
+                n += static_cast<std::size_t>(std::popcount(b.load(std::memory_order_relaxed)));
+            return n;
+        }
+    };
+
+    // The conditions held in this process are kept in a hashStorage as usual (handles, shared holders, waiters),
+    // each one is also claimed through Backend, where the other processes (or nodes) claim theirs, so a condition
+    // is held by one of them at a time. Shared holders (oneShared, sharedGet) share only within a process.
+    // Backend is default constructed, one per registry, and called under the lock of the registry:
+    /*
+    struct backend {
+        template <typename Q> bool claim(const Q &k);       // hold k here, ret false if held elsewhere (it may throw)
+        template <typename Q> void release(const Q &k) noexcept; // k is no longer held here
+        template <typename Q> bool held(const Q &k) noexcept; // held anywhere, this process included
+        // Optional: call wake(k) once k may be free, if it is free already soon. Without it a caller waiting for k
+        // (Opt::waitForRelease, acquire) is only woken by releases in this process, for others it waits out its time out.
+        void watch(const Key &k, void (*wake)(const Key &) noexcept);
+    };
+    */
+    template <typename Key, typename Backend, typename Hash = tupleHash<Key>, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+    class backedStorage {
+    private:
+        using storage = hashStorage<Key, Hash, Alloc>;
+        Lock lock;
+        storage table;
+        mutable Backend backend;
+
+    public:
+        using handle = typename storage::handle;
+        using extracted = typename storage::extracted;
+
+        static inline const Key &key(handle h) noexcept {
+            return storage::key(h);
+        }
+        static inline std::size_t &shares(handle h) noexcept {
+            return storage::shares(h);
+        }
+        static inline void *&payload(handle h) noexcept {
+            return storage::payload(h);
+        }
+        // Only the conditions held in this process. The caller holds lockFor(k), as for the other members.
+        template <typename Q>
+        inline handle lookup(const Q &k) const noexcept {
+            return table.lookup(k);
+        }
+        template <typename Q>
+        inline Lock &lockFor(const Q &) noexcept {
+            return lock;
+        }
+        // Held anywhere.
+        template <typename Q>
+        inline bool contains(const Q &k) const noexcept {
+            return table.contains(k) || backend.held(k);
+        }
+        // ret nullptr if it is held elsewhere.
+        template <typename Q>
+        inline handle insert(Q &&k) {
+            if (!backend.claim(k))
+                return nullptr;
+            try {
+                return table.insert(std::forward<Q>(k));
+            } catch (...) {
+                // k is intact unless making Key threw half way through moving it, its claim is left to the end of the process then.
+                backend.release(k);
+                throw;
+            }
+        }
+        template <typename Q>
+        inline bool erase(const Q &k) noexcept {
+            handle h = table.lookup(k);
+            if (h)
+                extract(h);
+            return h;
+        }
+        inline extracted extract(handle h) noexcept {
+            backend.release(storage::key(h));
+            return table.extract(h);
+        }
+        template <typename Q, typename Probe = noProbe>
+        inline status tryEmplace(Q &&k, const std::chrono::milliseconds &t, handle &h, Probe &&probe = Probe{}) {
+            if (!lock.try_lock_for(t))
+                return status::timeOut;
+            std::unique_lock<Lock> guard(lock, std::adopt_lock);
+            probe();
+            h = table.contains(k) ? nullptr : insert(std::forward<Q>(k));
+            return h ? status::ok : status::same;
+        }
+        template <typename Wake>
+        inline void watch(const Key &k, Wake wake)
+            requires requires(Backend &b) { b.watch(k, wake); }
+        {
+            backend.watch(k, wake);
+        }
+        // Held in this process.
+        inline std::size_t size() const noexcept {
+            return table.size();
+        }
+    };
+
+    // The name of a registry outside the process as a template argument, e.g. shmRegistry<"/myapp.files">.
+    template <std::size_t N>
+    struct registryName {
+        char value[N];
+        constexpr registryName(const char (&s)[N]) {
+            std::copy_n(s, N, value);
+        }
+    };
+
+    // registry policies, choose one through oneTraits<T, Conditions...>::registry
+    // Alloc is the allocator policy of the nodes, oneTraits<T, Conditions...>::allocator,
+    // and Lock the lock policy, oneTraits<T, Conditions...>::lock.
+    struct vectorRegistry {
+        template <typename Key, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+        using type = lockedStorage<vectorStorage<Key, Alloc>, Lock>;
+    };
+    struct hashRegistry {
+        template <typename Key, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+        using type = lockedStorage<hashStorage<Key, tupleHash<Key>, Alloc>, Lock>;
+    };
+    // Striped locking, conditions with different hashes go to different locks.
+    template <std::size_t Shards = 16>
+    struct shardedRegistry {
+        template <typename Key, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+        using type = shardedStorage<Key, Shards, tupleHash<Key>, Alloc, Lock>;
+    };
+    // verified() never takes a lock, for read-mostly queries.
+    struct lockFreeRegistry {
+        template <typename Key, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+        using type = lockFreeStorage<Key, tupleHash<Key>, Alloc, Lock>;
+    };
+    // For a single bounded<Lo, Hi> condition, a bit per value (the nodes are in place, Alloc is not used).
+    struct boundedRegistry {
+        template <typename Key, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+        using type = boundedStorage<Key, Lock>;
+    };
+
+    template <typename... Conditions>
+    inline constexpr bool isBoundedKey = false;
+    template <auto Lo, auto Hi>
+    inline constexpr bool isBoundedKey<bounded<Lo, Hi>> = true;
+
+    // Log2 buckets of nanoseconds, bucket i counts the durations in [2^(i-1), 2^i).
+    class latencyHistogram {
+    private:
+        std::atomic<std::uint64_t> buckets[64] = {};
+
+    public:
+        struct snapshot {
+            std::uint64_t counts[64] = {};
+            inline std::uint64_t total() const noexcept {
+                std::uint64_t n = 0;
+                for (std::uint64_t c : counts)
+                    n += c;
+                return n;
+            }
+            // Upper bound of the q (0 ~ 1) quantile.
+            inline std::chrono::nanoseconds percentile(double q) const noexcept {
+                std::uint64_t n = total(), seen = 0;
+                if (n == 0)
+                    return std::chrono::nanoseconds(0);
+                for (int i = 0; i < 64; ++i) {
+                    seen += counts[i];
+                    if (static_cast<double>(seen) >= q * static_cast<double>(n))
+                        return std::chrono::nanoseconds(i == 0 ? 0 : (i >= 63 ? INT64_MAX : (std::int64_t(1) << i)));
+                }
+                return std::chrono::nanoseconds(INT64_MAX);
+            }
+        };
+
+        inline void record(std::chrono::nanoseconds d) noexcept {
+            auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(d.count(), 0));
+            buckets[std::min<int>(std::bit_width(ns), 63)].fetch_add(1, std::memory_order_relaxed);
+        }
+        inline snapshot read() const noexcept {
+            snapshot s;
+            for (int i = 0; i < 64; ++i)
+                s.counts[i] = buckets[i].load(std::memory_order_relaxed);
+            return s;
+        }
+    };
+
+    // stats policies, choose one through oneTraits<T, Conditions...>::stats
+    // Nothing is measured and no clock is read, the default.
+    struct noStats {
+        static constexpr bool enabled = false;
+    };
+    // Per type atomic counters and latency histograms, read them with oneMethod<T, Conditions...>::statistics().
+    class basicStats {
+    private:
+        std::atomic<std::uint64_t> acquires{0}, conflicts{0}, timeOuts{0}, releases{0}, overloads{0};
+        std::atomic<std::size_t> live{0}, peak{0};
+        latencyHistogram lockWaits, lookups, holds;
+
+    public:
+        static constexpr bool enabled = true;
+
+        struct snapshot {
+            std::uint64_t acquires, conflicts, timeOuts, releases;
+            // Conditions in the registry now, and at most.
+            std::size_t size, peakSize;
+            // Waiting for the lock, lookup and insert under the lock, guard lifetime.
+            latencyHistogram::snapshot lockWait, lookup, held;
+            // Turned away by adaptiveTimeOut.
+            std::uint64_t overloads;
+        };
+
+        inline void acquire(status st, std::chrono::nanoseconds lockWait, std::chrono::nanoseconds lookup) noexcept {
+            if (st == status::overload) {
+                overloads.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            lockWaits.record(lockWait);
+            if (st == status::timeOut) {
+                timeOuts.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            lookups.record(lookup);
+            if (st == status::same)
+                conflicts.fetch_add(1, std::memory_order_relaxed);
+        }
+        inline void inserted(std::size_t n) noexcept {
+            acquires.fetch_add(n, std::memory_order_relaxed);
+            std::size_t now = live.fetch_add(n, std::memory_order_relaxed) + n;
+            std::size_t p = peak.load(std::memory_order_relaxed);
+            while (p < now && !peak.compare_exchange_weak(p, now, std::memory_order_relaxed)) {
+            }
+        }
+        inline void erased(std::size_t n) noexcept {
+            releases.fetch_add(n, std::memory_order_relaxed);
+            live.fetch_sub(n, std::memory_order_relaxed);
+        }
+        inline void held(std::chrono::nanoseconds d) noexcept {
+            holds.record(d);
+        }
+        inline snapshot read() const noexcept {
+            return {acquires.load(std::memory_order_relaxed), conflicts.load(std::memory_order_relaxed),
+                    timeOuts.load(std::memory_order_relaxed), releases.load(std::memory_order_relaxed),
+                    live.load(std::memory_order_relaxed), peak.load(std::memory_order_relaxed),
+                    lockWaits.read(), lookups.read(), holds.read(), overloads.load(std::memory_order_relaxed)};
+        }
+    };
+
+    // time out policies, choose one through oneTraits<T, Conditions...>::timeout
+    // The time out of the guards of the type when none is passed, in milliseconds.
+    template <std::size_t Ms = 5000>
+    struct fixedTimeOut {
+        static constexpr bool adaptive = false;
+        static constexpr std::chrono::milliseconds value{Ms};
+    };
+    // Fail fast under overload instead of piling up for the whole time out. The default time out is Ms, but the lock is
+    // waited for at most Factor times its recent mean wait (at least FloorMs), and with MaxAcquiring threads acquiring
+    // the type already, an acquisition gets status::overload (overloadException) without trying the lock.
+    // The recent lock waits and conflicts are kept here (not basicStats, that may be off), see oneMethod<...>::load().
+    template <std::size_t Ms = 5000, std::size_t MaxAcquiring = 64, std::size_t Factor = 8, std::size_t FloorMs = 1>
+    class adaptiveTimeOut {
+    private:
+        std::atomic<std::size_t> acquiring{0};
+        // Moving averages, of the lock wait in nanoseconds and of the conflicts in 1/1024.
+        std::atomic<std::int64_t> wait{0};
+        std::atomic<std::int64_t> conflicts{0};
+
+        inline std::chrono::milliseconds bound() const noexcept {
+            auto w = std::chrono::ceil<std::chrono::milliseconds>(std::chrono::nanoseconds(wait.load(std::memory_order_relaxed) * std::int64_t(Factor)));
+            return std::max(w, std::chrono::milliseconds(FloorMs));
+        }
+
+    public:
+        static constexpr bool adaptive = true;
+        static constexpr std::chrono::milliseconds value{Ms};
+
+        struct snapshot {
+            // Threads acquiring the type now.
+            std::size_t acquiring;
+            // Recent mean lock wait, and the lock wait allowed now.
+            std::chrono::nanoseconds lockWait;
+            std::chrono::milliseconds bound;
+            // Recent share of the acquisitions that found the same condition, 0 to 1.
+            double conflictRate;
+        };
+
+        // ret false if it is overloaded, otherwise t is shortened to the bound and leave() is due.
+        inline bool enter(std::chrono::milliseconds &t) noexcept {
+            if (acquiring.fetch_add(1, std::memory_order_relaxed) >= MaxAcquiring) {
+                acquiring.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+            t = std::min(t, bound());
+            return true;
+        }
+        // Lost updates of the averages from concurrent leaves are fine.
+        inline void leave(status st, std::chrono::nanoseconds lockWait) noexcept {
+            acquiring.fetch_sub(1, std::memory_order_relaxed);
+            std::int64_t w = wait.load(std::memory_order_relaxed);
+            wait.store(w + (lockWait.count() - w) / 8, std::memory_order_relaxed);
+            if (st == status::timeOut)
+                return;
+            std::int64_t c = conflicts.load(std::memory_order_relaxed);
+            conflicts.store(c + ((st == status::same ? 1024 : 0) - c) / 16, std::memory_order_relaxed);
+        }
+        inline snapshot read() const noexcept {
+            return {acquiring.load(std::memory_order_relaxed), std::chrono::nanoseconds(wait.load(std::memory_order_relaxed)),
+                    bound(), double(conflicts.load(std::memory_order_relaxed)) / 1024};
+        }
+    };
+
+    // A key of a side table that points to the condition tuple kept in its entry, so it is not copied twice.
+    // Also looked up by a tuple the conditions can be compared with (see borrow).
+    template <typename Key>
+    struct keyRef {
+        const Key *k;
+    };
+    template <typename Key>
+    struct keyRefHash {
+        using is_transparent = void;
+        template <typename Q>
+        static inline std::size_t of(const Q &q) noexcept {
+            if constexpr (isKeyHashable<Key>)
+                return tupleHash<Key>{}(q);
+            else
+                return 0;
+        }
+        inline std::size_t operator()(const keyRef<Key> &r) const noexcept {
+            return of(*r.k);
+        }
+        template <typename Q>
+        inline std::size_t operator()(const Q &q) const noexcept {
+            return of(q);
+        }
+    };
+    template <typename Key>
+    struct keyRefEqual {
+        using is_transparent = void;
+        inline bool operator()(const keyRef<Key> &a, const keyRef<Key> &b) const noexcept {
+            return *a.k == *b.k;
+        }
+        template <typename Q>
+        inline bool operator()(const keyRef<Key> &a, const Q &q) const noexcept {
+            return *a.k == q;
+        }
+        template <typename Q>
+        inline bool operator()(const Q &q, const keyRef<Key> &a) const noexcept {
+            return *a.k == q;
+        }
+    };
+
+    // pool policies, choose one through oneTraits<T, Conditions...>::pool
+    // A released object is destroyed, the default.
+    struct noPool {
+        template <typename T, typename Key>
+        struct type {
+            static constexpr bool enabled = false;
+        };
+    };
+    // A released object of one (constructed using its condition) is kept for its condition instead of being destroyed,
+    // and the next one with the same condition takes it back as it was left, e.g. an open std::fstream at its position.
+    // At most Capacity objects of the type are kept, when it is full the least recently released one is destroyed.
+    // T should be move constructible. Objects constructed using constructArgs, or by default, are not kept.
+    template <std::size_t Capacity>
+    struct lruPool {
+        static_assert(Capacity > 0, "a pool of no objects is noPool");
+
+        template <typename T, typename Key>
+        class type {
+        private:
+            struct entry {
+                Key key;
+                T obj;
+            };
+            using ref = keyRef<Key>;
+            std::mutex mtx;
+            // The most recently released first.
+            std::list<entry> order;
+            std::unordered_map<ref, typename std::list<entry>::iterator, keyRefHash<Key>, keyRefEqual<Key>> index;
+
+        public:
+            static constexpr bool enabled = true;
+
+            // Move the object kept for k to at, ret false if there is none.
+            inline bool take(const Key &k, void *at) {
+                std::list<entry> e;
+                {
+                    std::lock_guard<std::mutex> guard(mtx);
+                    auto it = index.find(ref{&k});
+                    if (it == index.end())
+                        return false;
+                    e.splice(e.begin(), order, it->second);
+                    index.erase(it);
+                }
+                ::new (at) T(std::move(e.front().obj));
+                return true;
+            }
+            // Keep obj (moved from) for k. What is evicted is destroyed outside the lock, nothing is kept without memory.
+            inline void put(const Key &k, T &&obj) noexcept {
+                try {
+                    std::list<entry> e, evicted;
+                    e.push_back(entry{k, std::move(obj)});
+                    std::lock_guard<std::mutex> guard(mtx);
+                    if (auto it = index.find(ref{&k}); it != index.end()) {
+                        evicted.splice(evicted.end(), order, it->second);
+                        index.erase(it);
+                    } else if (order.size() >= Capacity) {
+                        index.erase(ref{&order.back().key});
+                        evicted.splice(evicted.end(), order, std::prev(order.end()));
+                    }
+                    index.emplace(ref{&e.front().key}, e.begin());
+                    order.splice(order.begin(), e);
+                } catch (...) {
+                }
+            }
+            inline std::size_t size() noexcept {
+                std::lock_guard<std::mutex> guard(mtx);
+                return order.size();
+            }
+        };
+    };
+
+    // affinity policies, choose one through oneTraits<T, Conditions...>::affinity
+    // Every release goes to the registry, the default.
+    struct noAffinity {
+        static constexpr bool enabled = false;
+        static constexpr std::size_t capacity = 0;
+    };
+    // For conditions acquired again and again by the same thread (e.g. per shard log files): a release keeps a lease of
+    // the thread on the condition instead of erasing it, for up to Capacity conditions per thread (the oldest is handed
+    // back), so the next acquire of it on that thread is a thread local hit, without the registry or its lock.
+    // Another thread asking for a leased condition (acquire, wait, oneShared, multiOne) revokes the lease and gets it,
+    // and a release with waiters hands the condition over as usual. A leased condition is still in the registry
+    // (size, verified), the stats count it once until it is handed back, and only askers of this process revoke it
+    // (not with shmRegistry or leaseRegistry).
+    template <std::size_t Capacity = 8>
+    struct threadAffinity {
+        static_assert(Capacity > 0, "an affinity of no conditions is noAffinity");
+        static constexpr bool enabled = true;
+        static constexpr std::size_t capacity = Capacity;
+    };
+
+    // holder tracing policies, choose one through oneTraits<T, Conditions...>::trace
+    struct noTrace {
+        static constexpr bool enabled = false;
+    };
+    // Every guard records the thread that acquired it and when, for oneMethod<T, Conditions...>::holders() (e.g. a periodic
+    // dump of what is held, to find a stuck resource). A guard links its record into a list of its thread, so it only
+    // takes the lock of that list (not contended but by a snapshot copying it).
+    struct traceHolders {
+        static constexpr bool enabled = true;
+    };
+    // A condition held by a guard, in a snapshot of holders().
+    template <typename Key>
+    struct heldCondition {
+        Key condition;
+        // That acquired it.
+        std::thread::id thread;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    // When the guard acquired its condition, empty if the stats are disabled.
+    template <bool Enabled>
+    struct holdStamp {
+        inline void start() noexcept {}
+    };
+    template <>
+    struct holdStamp<true> {
+        std::chrono::steady_clock::time_point at;
+        inline void start() noexcept {
+            at = std::chrono::steady_clock::now();
+        }
+    };
+
+    // Per type customization point of one<T, Conditions...> and oneR<T, Conditions...>, specialize it to change the policy:
+    /*
+    template <>
+    struct one::oneTraits<std::fstream, std::string> {
+        using registry = shardedRegistry<64>;
+    };
+    */
+    // By default the hashed registry is used when every condition has a conditionHash, otherwise the linear list,
+    // and boundedRegistry for a single bounded condition.
+    // A specialization only needs the members it changes, the others keep their default.
+    template <typename... Conditions>
+    using defaultRegistry = std::conditional_t<isBoundedKey<Conditions...>, boundedRegistry,
+                                               std::conditional_t<isKeyHashable<std::tuple<Conditions...>>, hashRegistry, vectorRegistry>>;
+
+    template <typename T, typename... Conditions>
+    struct oneTraits {
+        using registry = defaultRegistry<Conditions...>;
+        using stats = noStats;
+        using allocator = heapAllocator;
+        using lock = std::timed_mutex;
+        using pool = noPool;
+        using affinity = noAffinity;
+        using trace = noTrace;
+        using timeout = fixedTimeOut<>;
+    };
+
+    // Traits::Member if a specialization declares it, otherwise Default.
+    template <template <typename> class Member, typename Traits, typename Default, typename = void>
+    struct traitOr {
+        using type = Default;
+    };
+    template <template <typename> class Member, typename Traits, typename Default>
+    struct traitOr<Member, Traits, Default, std::void_t<Member<Traits>>> {
+        using type = Member<Traits>;
+    };
+    template <typename Traits>
+    using registryMember = typename Traits::registry;
+    template <typename Traits>
+    using statsMember = typename Traits::stats;
+    template <typename Traits>
+    using allocatorMember = typename Traits::allocator;
+    template <typename Traits>
+    using lockMember = typename Traits::lock;
+    template <typename Traits>
+    using poolMember = typename Traits::pool;
+    template <typename Traits>
+    using affinityMember = typename Traits::affinity;
+    template <typename Traits>
+    using traceMember = typename Traits::trace;
+    template <typename Traits>
+    using timeoutMember = typename Traits::timeout;
+
+    // hash of the condition tuple if it has one, otherwise the same for every condition.
+    template <typename Key>
+    inline std::size_t hashOf(const Key &k) noexcept {
+        if constexpr (isKeyHashable<Key>)
+            return tupleHash<Key>{}(k);
+        else
+            return 0;
+    }
+
+    struct waiterLink {
+        waiterLink *next = nullptr;
+        void *self = nullptr;
+        // Called once the condition has been inserted for this waiter, outside of all locks.
+        void (*wake)(void *self) noexcept = nullptr;
+    };
+
+    // Calls w->wake. A wake inside another one on this thread (a resumed coroutine releasing and handing off again)
+    // is queued and run by the outermost, so a chain of handoffs does not grow the stack.
+    inline void wakeWaiter(waiterLink *w) noexcept {
+        thread_local waiterLink *head = nullptr;
+        thread_local waiterLink *tail = nullptr;
+        thread_local bool waking = false;
+        w->next = nullptr;
+        if (waking) {
+            (tail ? tail->next : head) = w;
+            tail = w;
+            return;
+        }
+        waking = true;
+        w->wake(w->self);
+        while (head) {
+            waiterLink *n = head;
+            head = n->next;
+            if (!head)
+                tail = nullptr;
+            n->wake(n->self);
+        }
+        waking = false;
+    }
+
+    // A caller parked until the same condition is released, it lives in the caller (e.g. the coroutine frame).
+    template <typename Key>
+    struct waiter : waiterLink {
+        const Key *key = nullptr;
+        std::size_t hash = 0;
+        // The handle of the registry node, once the condition has been inserted for it.
+        void *node = nullptr;
+        // See Opt::waitForRelease. A waiter that can not time out (a coroutine) keeps the max deadline.
+        int priority = 0;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    };
+
+    // Waiters of each condition in grant order (priority, deadline, arrival), in buckets chosen by the hash, so a release
+    // only looks at its own bucket. A bucket is kept sorted, so the first waiter of a condition is the one to grant.
+    template <typename Key>
+    class waitQueue {
+    private:
+        // A line per bucket, the waiters of different buckets do not share one.
+        struct bucket {
+            alignas(lineOf<std::mutex>) std::mutex lock;
+            waiter<Key> *head = nullptr;
+            waiter<Key> *tail = nullptr;
+        };
+        // Waiters and callers about to park. Releases skip the buckets while it is 0, so it is read by every release
+        // and written only by waiters: a line of its own.
+        alignas(lineOf<std::atomic<std::size_t>>) std::atomic<std::size_t> waiting{0};
+        bucket buckets[64];
+
+        inline bucket &bucketFor(std::size_t h) noexcept {
+            return buckets[h & 63];
+        }
+        static inline waiter<Key> *next(waiter<Key> *w) noexcept {
+            return static_cast<waiter<Key> *>(w->next);
+        }
+        // Whether a is granted before b.
+        static inline bool before(const waiter<Key> &a, const waiter<Key> &b) noexcept {
+            return a.priority != b.priority ? a.priority > b.priority : a.deadline < b.deadline;
+        }
+        static inline void unlink(bucket &b, waiter<Key> *prev, waiter<Key> *w) noexcept {
+            if (prev)
+                prev->next = w->next;
+            else
+                b.head = next(w);
+            if (b.tail == w)
+                b.tail = prev;
+            w->next = nullptr;
+        }
+
+    public:
+        // No waiter and no caller about to park.
+        inline bool idle() const noexcept {
+            return waiting.load() == 0;
+        }
+        // Try again under the lock of the bucket and park w if the condition is still taken.
+        // ret status::same when w is parked, then w must not be touched by the caller until it is woken or cancel()ed.
+        template <typename Acquire>
+        inline status park(waiter<Key> &w, Acquire &&acquire) {
+            waiting.fetch_add(1);
+            bucket &b = bucketFor(w.hash);
+            std::lock_guard<std::mutex> guard(b.lock);
+            status st = acquire();
+            if (st != status::same) {
+                waiting.fetch_sub(1);
+                return st;
+            }
+            w.next = nullptr;
+            // Most waiters go last, a waiter of a higher priority or an earlier deadline goes before the first it precedes.
+            if (!b.tail || !before(w, *b.tail)) {
+                if (b.tail)
+                    b.tail->next = &w;
+                else
+                    b.head = &w;
+                b.tail = &w;
+                return status::same;
+            }
+            waiter<Key> *prev = nullptr, *p = b.head;
+            while (!before(w, *p)) {
+                prev = p;
+                p = next(p);
+            }
+            w.next = p;
+            if (prev)
+                prev->next = &w;
+            else
+                b.head = &w;
+            return status::same;
+        }
+        // Remove w if it is still parked, ret false if it was already woken.
+        inline bool cancel(waiter<Key> &w) noexcept {
+            bucket &b = bucketFor(w.hash);
+            std::lock_guard<std::mutex> guard(b.lock);
+            for (waiter<Key> *prev = nullptr, *p = b.head; p; prev = p, p = next(p))
+                if (p == &w) {
+                    unlink(b, prev, p);
+                    waiting.fetch_sub(1);
+                    return true;
+                }
+            return false;
+        }
+        // After k has been erased and its lock released: hand it to the first waiter of k, grant(w) inserts it again.
+        template <typename Grant>
+        inline void notify(const Key &k, std::size_t h, Grant &&grant) noexcept {
+            // park() increments before it takes the lock of k, and the erase was done under that lock,
+            // so either the waiter saw the erase or this sees the waiter.
+            if (waiting.load() == 0)
+                return;
+            waiter<Key> *woken = nullptr;
+            {
+                bucket &b = bucketFor(h);
+                std::lock_guard<std::mutex> guard(b.lock);
+                std::chrono::steady_clock::time_point now{};
+                for (waiter<Key> *prev = nullptr, *p = b.head; p; prev = p, p = next(p))
+                    if (p->hash == h && (isExactHash<tupleHash<Key>> || *p->key == k)) {
+                        // Expired, it is about to cancel itself. The clock is read once, for the first finite deadline.
+                        if (p->deadline != std::chrono::steady_clock::time_point::max()) {
+                            if (now == std::chrono::steady_clock::time_point{})
+                                now = std::chrono::steady_clock::now();
+                            if (p->deadline <= now)
+                                continue;
+                        }
+                        // Someone else took it in between, its release will notify again.
+                        if (grant(*p)) {
+                            unlink(b, prev, p);
+                            waiting.fetch_sub(1);
+                            woken = p;
+                        }
+                        break;
+                    }
+            }
+            if (woken)
+                wakeWaiter(woken);
+        }
+    };
+
+    // The distinct locks of a batch of conditions, taken in address order so two batches never deadlock.
+    template <typename Lock>
+    class lockSet {
+    private:
+        std::vector<Lock *> locks;
+        std::size_t held = 0;
+
+        inline void sort() {
+            std::sort(locks.begin(), locks.end(), std::less<Lock *>{});
+            locks.erase(std::unique(locks.begin(), locks.end()), locks.end());
+        }
+
+    public:
+        lockSet() = default;
+        lockSet(const lockSet &) = delete;
+        lockSet &operator=(const lockSet &) = delete;
+        ~lockSet() {
+            unlock();
+        }
+
+        // A lock repeated right away (one lock for the whole registry) is added once.
+        inline void add(Lock &m) {
+            if (locks.empty() || locks.back() != std::addressof(m))
+                locks.push_back(std::addressof(m));
+        }
+        inline bool tryLockUntil(const std::chrono::steady_clock::time_point &deadline) {
+            sort();
+            for (; held < locks.size(); ++held)
+                if (!locks[held]->try_lock_until(deadline)) {
+                    unlock();
+                    return false;
+                }
+            return true;
+        }
+        inline void lock() {
+            sort();
+            for (; held < locks.size(); ++held)
+                locks[held]->lock();
+        }
+        inline void unlock() noexcept {
+            while (held)
+                locks[--held]->unlock();
+        }
+    };
+
+    // base, save list
+    template <typename Registry, typename T, typename... Conditions>
+    class basicOneMethod {
+    private:
+        using statsType = typename traitOr<statsMember, oneTraits<T, Conditions...>, noStats>::type;
+        using allocatorType = typename traitOr<allocatorMember, oneTraits<T, Conditions...>, heapAllocator>::type;
+        using registryType = typename Registry::template type<std::tuple<Conditions...>, allocatorType,
+                                                              typename traitOr<lockMember, oneTraits<T, Conditions...>, std::timed_mutex>::type>;
+        // What lockFor returns, the lock policy unless the registry chooses its own.
+        using lockType = std::remove_reference_t<decltype(std::declval<registryType &>().lockFor(std::declval<const std::tuple<Conditions...> &>()))>;
+        // Each on lines of its own, so the state of one type (or of another type next to it) is not written together.
+        static padded<registryType> list;
+        static padded<waitQueue<std::tuple<Conditions...>>> waiters;
+        static padded<statsType> counters;
+        using poolType = typename traitOr<poolMember, oneTraits<T, Conditions...>, noPool>::type::template type<T, std::tuple<Conditions...>>;
+        static padded<poolType> pool;
+        using timeoutType = typename traitOr<timeoutMember, oneTraits<T, Conditions...>, fixedTimeOut<>>::type;
+        static padded<timeoutType> timeouts;
+        // The lock wait is timed, for the stats or the time out policy.
+        static constexpr bool timed = statsType::enabled || timeoutType::adaptive;
+        using affinityType = typename traitOr<affinityMember, oneTraits<T, Conditions...>, noAffinity>::type;
+        static constexpr bool affine = affinityType::enabled;
+
+        // The lease of a thread on a node (threadAffinity). Only its thread frees it, after it is out of the table.
+        struct lease {
+            enum : int {
+                held,     // by a guard
+                free,     // leased, its thread takes it without a lock
+                stealing, // by another thread that still reads it, under the table mutex
+                taken     // by another thread, out of the table
+            };
+            std::tuple<Conditions...> key;
+            typename registryType::handle node;
+            std::atomic<int> state{held};
+        };
+        // The leases of all threads by condition, for the threads that ask for them.
+        struct leaseTable {
+            std::mutex mtx;
+            std::unordered_map<keyRef<std::tuple<Conditions...>>, lease *, keyRefHash<std::tuple<Conditions...>>, keyRefEqual<std::tuple<Conditions...>>> map;
+            // Askers skip the table while it is 0.
+            std::atomic<std::size_t> count{0};
+        };
+        static padded<leaseTable> leaseOwners;
+
+        static constexpr bool traced = traitOr<traceMember, oneTraits<T, Conditions...>, noTrace>::type::enabled;
+        struct holderList;
+        // The record of a guard while it holds (traceHolders), in the list of the thread that acquired.
+        struct holder : holdStamp<true> {
+            std::thread::id thread;
+            const typename registryType::handle *nodes = nullptr;
+            std::size_t count = 0;
+            holderList *list = nullptr;
+            holder *prev = nullptr;
+            holder *next = nullptr;
+        };
+        // The records of a thread. A list is never freed, the one of an exited thread is taken by a new thread
+        // (along with the records of guards that outlive their thread).
+        struct holderList {
+            std::mutex mtx;
+            holder *first = nullptr;
+            holderList *next = nullptr;
+            std::atomic<bool> used{true};
+        };
+        struct holderLists {
+            // Only pushed to.
+            std::atomic<holderList *> first{nullptr};
+        };
+        static padded<holderLists> holderHeads;
+        static holderList *ownList() {
+            struct mine {
+                holderList *l = nullptr;
+                ~mine() {
+                    if (l)
+                        l->used.store(false, std::memory_order_release);
+                }
+            };
+            thread_local mine m;
+            if (m.l)
+                return m.l;
+            for (holderList *l = holderHeads.first.load(std::memory_order_acquire); l; l = l->next) {
+                bool used = false;
+                if (!l->used.load(std::memory_order_relaxed) && l->used.compare_exchange_strong(used, true, std::memory_order_acquire))
+                    return m.l = l;
+            }
+            holderList *l = new holderList;
+            l->next = holderHeads.first.load(std::memory_order_relaxed);
+            while (!holderHeads.first.compare_exchange_weak(l->next, l, std::memory_order_release, std::memory_order_relaxed))
+                ;
+            return m.l = l;
+        }
+        // The leases of this thread, the most recent last. At thread exit the free ones are handed back.
+        struct leaseCache {
+            std::array<lease *, affinityType::capacity> slots{};
+            std::size_t n = 0;
+            inline void remove(std::size_t i) noexcept {
+                for (; i + 1 < n; ++i)
+                    slots[i] = slots[i + 1];
+                --n;
+            }
+            ~leaseCache() {
+                while (n)
+                    handBack(slots[--n]);
+            }
+        };
+        static leaseCache &leases() noexcept {
+            thread_local leaseCache c;
+            return c;
+        }
+        static void unregister(lease *l) noexcept {
+            std::lock_guard<std::mutex> guard(leaseOwners.mtx);
+            auto it = leaseOwners.map.find(keyRef<std::tuple<Conditions...>>{&l->key});
+            if (it != leaseOwners.map.end() && it->second == l) {
+                leaseOwners.map.erase(it);
+                leaseOwners.count.fetch_sub(1);
+            }
+        }
+        // By the thread of l: release its node if it is free, then l is gone.
+        static void handBack(lease *l) noexcept {
+            int st = lease::free;
+            if (l->state.compare_exchange_strong(st, lease::held)) {
+                unregister(l);
+                dropNode(l->node, []() noexcept {});
+            } else if (st == lease::held)
+                // Its guard releases it as usual.
+                unregister(l);
+            else if (st == lease::stealing)
+                // The stealer is done with l once it leaves the mutex.
+                std::lock_guard<std::mutex> guard(leaseOwners.mtx);
+            delete l;
+        }
+        // The lease of this thread held for h (matched by conditions too, a freed node may come back for others), or null.
+        static lease *heldLease(leaseCache &c, typename registryType::handle h, std::size_t &at) noexcept {
+            for (std::size_t i = c.n; i--;)
+                if (c.slots[i]->node == h && c.slots[i]->state.load(std::memory_order_relaxed) == lease::held &&
+                    c.slots[i]->key == registryType::key(h)) {
+                    at = i;
+                    return c.slots[i];
+                }
+            return nullptr;
+        }
+        // h is released without a lease (dropped, or to a releaseGroup): the lease this thread held for it is gone.
+        static void forget(typename registryType::handle h) noexcept {
+            leaseCache &c = leases();
+            std::size_t i;
+            if (lease *l = heldLease(c, h, i)) {
+                unregister(l);
+                c.remove(i);
+                delete l;
+            }
+        }
+        // The lease of this thread on k, taken without a lock. A lease taken by another thread is dropped.
+        template <typename Q>
+        static bool reclaim(const Q &k, typename registryType::handle &h) noexcept {
+            leaseCache &c = leases();
+            for (std::size_t i = c.n; i--;) {
+                lease *l = c.slots[i];
+                if (!(l->key == k))
+                    continue;
+                int st = lease::free;
+                if (l->state.compare_exchange_strong(st, lease::held)) {
+                    h = l->node;
+                    return true;
+                }
+                if (st == lease::taken) {
+                    c.remove(i);
+                    delete l;
+                }
+                return false;
+            }
+            return false;
+        }
+        // Revoke the lease another thread has on k, h is its node then (still inserted, held by the caller).
+        template <typename Q>
+        static bool steal(const Q &k, typename registryType::handle &h) noexcept {
+            if (leaseOwners.count.load() == 0)
+                return false;
+            std::lock_guard<std::mutex> guard(leaseOwners.mtx);
+            auto it = leaseOwners.map.find(k);
+            if (it == leaseOwners.map.end())
+                return false;
+            lease *l = it->second;
+            int st = lease::free;
+            if (!l->state.compare_exchange_strong(st, lease::stealing))
+                return false;
+            // Its thread deletes it once it is taken, and the entry points to its key: done with both first.
+            h = l->node;
+            leaseOwners.map.erase(it);
+            leaseOwners.count.fetch_sub(1);
+            l->state.store(lease::taken);
+            return true;
+        }
+        // Release h by leasing it to this thread (then() runs, ret true), unless someone waits for it.
+        template <typename Then>
+        static bool keep(typename registryType::handle h, Then &then) noexcept {
+            if (!waiters.idle()) {
+                forget(h);
+                return false;
+            }
+            leaseCache &c = leases();
+            std::size_t at;
+            lease *l = heldLease(c, h, at);
+            if (!l) {
+                // Acquired through the registry, or by a guard of another thread.
+                try {
+                    l = new lease{registryType::key(h), h};
+                    std::lock_guard<std::mutex> guard(leaseOwners.mtx);
+                    auto it = leaseOwners.map.find(l->key);
+                    if (it != leaseOwners.map.end()) {
+                        // The lease of the thread that acquired it, its thread drops it. The entry points to its key,
+                        // so it is replaced rather than reused.
+                        lease *old = it->second;
+                        leaseOwners.map.erase(it);
+                        leaseOwners.count.fetch_sub(1);
+                        old->state.store(lease::taken);
+                    }
+                    leaseOwners.map.emplace(keyRef<std::tuple<Conditions...>>{&l->key}, l);
+                    leaseOwners.count.fetch_add(1);
+                } catch (...) {
+                    delete l;
+                    return false;
+                }
+                if (c.n == c.slots.size()) {
+                    handBack(c.slots[0]);
+                    c.remove(0);
+                }
+                c.slots[c.n++] = l;
+            }
+            then();
+            l->state.store(lease::free);
+            // A waiter that came meanwhile either sees the lease (and steals it) or is seen here.
+            if (!waiters.idle()) {
+                int st = lease::free;
+                if (l->state.compare_exchange_strong(st, lease::held)) {
+                    unregister(l);
+                    for (std::size_t i = c.n; i--;)
+                        if (c.slots[i] == l) {
+                            c.remove(i);
+                            break;
+                        }
+                    delete l;
+                    dropNode(h, []() noexcept {});
+                }
+            }
+            return true;
+        }
+        // Erase the node of h (no lookup) and wake the first waiter of its conditions, then() runs first, while the lock is held
+        // (a registry with lockFreeExtract takes no lock, the node is only erased after then()).
+        template <typename Then>
+        static void dropNode(typename registryType::handle h, Then &&then) noexcept {
+            if constexpr (requires { requires registryType::lockFreeExtract; }) {
+                then();
+                auto n = list.extract(h);
+                erased(1);
+                notify(n->key);
+            } else {
+                lockType &mtx = list.lockFor(h);
+                mtx.lock();
+                then();
+                auto n = list.extract(h);
+                erased(1);
+                mtx.unlock();
+                notify(n->key);
+            }
+        }
+
+        static inline void inserted(std::size_t n) noexcept {
+            if constexpr (statsType::enabled)
+                counters.inserted(n);
+        }
+        static inline void erased(std::size_t n) noexcept {
+            if constexpr (statsType::enabled)
+                counters.erased(n);
+        }
+        // The arguments borrowed for a lookup, the conditions are made only for the ones that can not be borrowed.
+        template <typename... Args>
+        static inline auto view(Args&&... args) {
+            return std::tuple<decltype(borrow<Conditions>(std::forward<Args>(args)))...>(borrow<Conditions>(std::forward<Args>(args))...);
+        }
+        // With a registry whose contains needs no lock (lockFreeContains), a conflict is answered by a lookup alone.
+        // Not before parking, a waiter takes the lock so that it sees the release it waits for.
+        template <typename Q>
+        static inline bool seenHeld(const Q &k) noexcept {
+            // A leased condition is still in the registry, it is revoked in tryEmplaceKey.
+            if constexpr (!affine && requires { requires registryType::lockFreeContains; }) {
+                if (!list.contains(k))
+                    return false;
+                if constexpr (statsType::enabled)
+                    counters.acquire(status::same, {}, {});
+                return true;
+            } else
+                return false;
+        }
+        // With adaptiveTimeOut: ret false (status::overload) if too many threads are acquiring, otherwise t is shortened
+        // to what the recent lock waits allow, and settle() is due.
+        static inline bool admit(std::chrono::milliseconds &t) noexcept {
+            if constexpr (timeoutType::adaptive) {
+                if (timeouts.enter(t))
+                    return true;
+                if constexpr (statsType::enabled)
+                    counters.acquire(status::overload, {}, {});
+                return false;
+            } else
+                return true;
+        }
+        static inline void settle(status st, std::chrono::nanoseconds lockWait) noexcept {
+            if constexpr (timeoutType::adaptive)
+                timeouts.leave(st, lockWait);
+        }
+        template <typename Q>
+        static inline status tryInsertKey(Q &&k, typename registryType::handle &h, std::chrono::milliseconds t) {
+            if constexpr (!timed)
+                return list.tryEmplace(std::forward<Q>(k), t, h);
+            else {
+                if (!admit(t))
+                    return status::overload;
+                auto start = std::chrono::steady_clock::now();
+                auto locked = start;
+                status st = list.tryEmplace(std::forward<Q>(k), t, h, [&locked]() noexcept { locked = std::chrono::steady_clock::now(); });
+                auto end = std::chrono::steady_clock::now();
+                if (st == status::timeOut)
+                    locked = end;
+                settle(st, locked - start);
+                if constexpr (statsType::enabled) {
+                    counters.acquire(st, locked - start, end - locked);
+                    if (st == status::ok)
+                        counters.inserted(1);
+                }
+                return st;
+            }
+        }
+        // k is only moved from if it is inserted, so a leased one is looked up after.
+        template <typename Q>
+        static inline status tryEmplaceKey(Q &&k, typename registryType::handle &h, const std::chrono::milliseconds &t) {
+            status st = tryInsertKey(std::forward<Q>(k), h, t);
+            if constexpr (affine)
+                if (st == status::same && steal(k, h))
+                    return status::ok;
+            return st;
+        }
+        // Revoke a lease on k to the registry, for the callers that acquire it in their own way (shared, all at once).
+        // ret true if there was one, then k is no longer in the registry.
+        template <typename Q>
+        static inline bool revoke(const Q &k) noexcept {
+            if constexpr (affine) {
+                typename registryType::handle h;
+                if (steal(k, h)) {
+                    dropNode(h, []() noexcept {});
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    public:
+        using stamp = std::conditional_t<traced, holder, holdStamp<statsType::enabled>>;
+        // The registry node holding the conditions of a guard, valid until it is released.
+        using handle = typename registryType::handle;
+
+        static const std::tuple<Conditions...> &conditionOf(handle h) noexcept {
+            return registryType::key(h);
+        }
+        // Holders of a shared node and what they share, only under lockFor (i.e. in the callbacks of tryJoinNode and leaveNode).
+        static std::size_t &sharesOf(handle h) noexcept {
+            return registryType::shares(h);
+        }
+        static void *&payloadOf(handle h) noexcept {
+            return registryType::payload(h);
+        }
+
+        // Counters and histograms of this type, only if oneTraits<T, Conditions...>::stats is enabled (e.g. basicStats).
+        static auto statistics() noexcept
+            requires statsType::enabled
+        {
+            return counters.read();
+        }
+        // The time out of the guards when none is passed, see oneTraits<T, Conditions...>::timeout.
+        static constexpr std::chrono::milliseconds defaultTimeOut = timeoutType::value;
+        // What adaptiveTimeOut decides with: threads acquiring now, recent lock waits and conflicts.
+        // e.g. to shed load before acquiring at all.
+        static auto load() noexcept
+            requires timeoutType::adaptive
+        {
+            return timeouts.read();
+        }
+        // Whether released objects are kept by oneTraits<T, Conditions...>::pool.
+        static constexpr bool pooled = poolType::enabled;
+        // Construct at `at` the object kept for k, ret false if there is none. The caller holds k.
+        static bool recycle(const std::tuple<Conditions...> &k, void *at)
+            requires pooled
+        {
+            return pool.take(k, at);
+        }
+        // Keep obj (moved from) for the next holder of k, before k is released.
+        static void park(const std::tuple<Conditions...> &k, T &obj) noexcept
+            requires pooled
+        {
+            pool.put(k, std::move(obj));
+        }
+        // Objects kept now.
+        static std::size_t pooledSize() noexcept
+            requires pooled
+        {
+            return pool.size();
+        }
+        // A guard acquired nodes (count of them, they stay there until it releases), s records it.
+        static void acquired(stamp &s, const handle *nodes, std::size_t count = 1) noexcept {
+            s.start();
+            if constexpr (traced) {
+                s.thread = std::this_thread::get_id();
+                s.nodes = nodes;
+                s.count = count;
+                holderList *l;
+                try {
+                    l = ownList();
+                } catch (...) {
+                    // No memory for a list, this guard is not traced.
+                    return;
+                }
+                std::lock_guard<std::mutex> guard(l->mtx);
+                s.list = l;
+                s.next = l->first;
+                if (s.next)
+                    s.next->prev = &s;
+                l->first = &s;
+            }
+        }
+        // The guard recorded by s releases its conditions, before its nodes are released.
+        static void released(stamp &s) noexcept {
+            if constexpr (traced)
+                if (holderList *l = s.list) {
+                    std::lock_guard<std::mutex> guard(l->mtx);
+                    (s.prev ? s.prev->next : l->first) = s.next;
+                    if (s.next)
+                        s.next->prev = s.prev;
+                    s.list = nullptr;
+                    s.prev = s.next = nullptr;
+                }
+            if constexpr (statsType::enabled)
+                counters.held(std::chrono::steady_clock::now() - s.at);
+        }
+        // A copy of the conditions held by guards now, with the thread that acquired each and when, only if
+        // oneTraits<T, Conditions...>::trace is traceHolders. Acquisitions are not stopped: the list of each thread is
+        // copied in turn, so only a guard of that thread acquiring or releasing meanwhile waits for the copy.
+        // Each list is a consistent view, the lists are not of the same instant.
+        static std::vector<heldCondition<std::tuple<Conditions...>>> holders()
+            requires traced
+        {
+            std::vector<heldCondition<std::tuple<Conditions...>>> v;
+            for (holderList *l = holderHeads.first.load(std::memory_order_acquire); l; l = l->next) {
+                std::lock_guard<std::mutex> guard(l->mtx);
+                for (holder *h = l->first; h; h = h->next)
+                    for (std::size_t i = 0; i < h->count; ++i)
+                        v.push_back({conditionOf(h->nodes[i]), h->thread, h->at});
+            }
+            return v;
+        }
+
+        // The nodes collected by the innermost releaseGroup of this thread, null if there is none.
+        static std::vector<handle> *&deferred() noexcept {
+            thread_local std::vector<handle> *group = nullptr;
+            return group;
+        }
+
+        // The lock that guards this condition, the whole list or only its shard depending on the registry.
+        template <typename... Args>
+        static lockType &lockFor(const Args&... args) noexcept {
+            return list.lockFor(view(args...));
+        }
+
+        static lockType &lockFor(const std::tuple<Conditions...> &t) noexcept {
+            return list.lockFor(t);
+        }
+        template <typename... Args>
+        static void add(Args&&... args) noexcept {
+            if (list.insert(std::tuple<Conditions...>(std::forward<Args>(args)...)))
+                inserted(1);
+        }
+
+        static void add(std::tuple<Conditions...> &&t) noexcept {
+            if (list.insert(std::move(t)))
+                inserted(1);
+        }
+        // Only lockFreeRegistry allows it without holding lockFor, other registries may be modified during the traversal.
+        // Arguments the conditions can be compared with (e.g. std::string_view or const char* for std::string) are not copied.
+        template <typename... Args>
+        static bool verified(const Args&... args) noexcept {
+            return list.contains(view(args...));
+        }
+
+        static bool verified(const std::tuple<Conditions...> &t) noexcept {
+            return list.contains(t);
+        }
+        template <typename... Args>
+        static void erase(const Args&... args) noexcept {
+            if (revoke(view(args...)))
+                return;
+            if (list.erase(view(args...)))
+                erased(1);
+        }
+
+        static void erase(const std::tuple<Conditions...> &t) noexcept {
+            if (revoke(t))
+                return;
+            if (list.erase(t))
+                erased(1);
+        }
+        // Atomic check and insert, it takes the lock itself (do not hold lockFor).
+        // ret status::ok if inserted, status::same if the same condition already exists, status::timeOut if time out get lock.
+        // The conditions are made from args only if inserted.
+        template <typename... Args>
+        static status tryEmplace(const std::chrono::milliseconds &t, const Args&... args) {
+            handle h;
+            auto k = view(args...);
+            return seenHeld(k) ? status::same : tryEmplaceKey(std::move(k), h, t);
+        }
+        static status tryEmplace(const std::chrono::milliseconds &t, const std::tuple<Conditions...> &k) {
+            handle h;
+            return seenHeld(k) ? status::same : tryEmplaceKey(k, h, t);
+        }
+        // Like tryEmplace, h is the node holding the conditions if inserted. Rvalue args are moved into it, and only then.
+        template <typename... Args>
+        static status tryEmplaceNode(const std::chrono::milliseconds &t, handle &h, Args&&... args) {
+            auto k = view(std::forward<Args>(args)...);
+            if constexpr (affine)
+                if (reclaim(k, h))
+                    return status::ok;
+            return seenHeld(k) ? status::same : tryEmplaceKey(std::move(k), h, t);
+        }
+        // Erase the node of h (no lookup) and wake the first waiter of its conditions, then() runs first, while the lock is held
+        // (a registry with lockFreeExtract takes no lock, the node is only erased after then()).
+        // With threadAffinity and no waiter, the node is leased to this thread instead, then() runs without a lock.
+        template <typename Then>
+        static void releaseNode(handle h, Then &&then) noexcept {
+            if (std::vector<handle> *group = deferred()) {
+                // Released with the group, then() runs now.
+                try {
+                    group->push_back(h);
+                    if constexpr (affine)
+                        forget(h);
+                    then();
+                    return;
+                } catch (...) {
+                }
+            }
+            if constexpr (affine)
+                if (keep(h, then))
+                    return;
+            dropNode(h, std::forward<Then>(then));
+        }
+        // Under the lock of the conditions: if there is no node of them, one is inserted and create(h) runs (if it throws,
+        // the node is removed again), otherwise join(h) decides whether h is shared (ret false for status::same).
+        // Rvalue args are moved into the node, and only if it is inserted. A registry shared with other processes
+        // may refuse the insert (ret nullptr), that is status::same too.
+        template <typename Create, typename Join, typename... Args>
+        static status tryJoinNode(std::chrono::milliseconds t, handle &h, Create &&create, Join &&join, Args&&... args) {
+            auto k = view(std::forward<Args>(args)...);
+            revoke(k);
+            if (!admit(t))
+                return status::overload;
+            lockType &mtx = list.lockFor(k);
+            [[maybe_unused]] std::chrono::steady_clock::time_point start, locked;
+            if constexpr (timed)
+                start = std::chrono::steady_clock::now();
+            if (!mtx.try_lock_for(t)) {
+                if constexpr (timed) {
+                    auto end = std::chrono::steady_clock::now();
+                    settle(status::timeOut, end - start);
+                    if constexpr (statsType::enabled)
+                        counters.acquire(status::timeOut, end - start, {});
+                }
+                return status::timeOut;
+            }
+            std::unique_lock<lockType> guard(mtx, std::adopt_lock);
+            if constexpr (timed)
+                locked = std::chrono::steady_clock::now();
+            status st = status::ok;
+            try {
+                h = list.lookup(k);
+                if (!h) {
+                    h = list.insert(std::move(k));
+                    if (!h)
+                        st = status::same;
+                    else {
+                        try {
+                            create(h);
+                        } catch (...) {
+                            list.extract(h);
+                            h = nullptr;
+                            throw;
+                        }
+                        inserted(1);
+                    }
+                } else if (!join(h)) {
+                    h = nullptr;
+                    st = status::same;
+                }
+            } catch (...) {
+                // insert or create threw: no time out and no conflict, the lock was taken. The exception is passed on.
+                settle(status::ok, locked - start);
+                throw;
+            }
+            settle(st, locked - start);
+            if constexpr (statsType::enabled)
+                counters.acquire(st, locked - start, std::chrono::steady_clock::now() - locked);
+            return st;
+        }
+        // Under the lock of h: if last() (it cleans up what it owns then) the node is erased and the first waiter woken.
+        template <typename Last>
+        static void leaveNode(handle h, Last &&last) noexcept {
+            lockType &mtx = list.lockFor(h);
+            mtx.lock();
+            if (!last()) {
+                mtx.unlock();
+                return;
+            }
+            auto n = list.extract(h);
+            erased(1);
+            mtx.unlock();
+            notify(n->key);
+        }
+        // Shared acquisition (oneShared): inserted with one holder or joined if it is held shared, h is the node then.
+        // ret status::same if it is held exclusively (or by sharedGet).
+        template <typename... Args>
+        static status tryShareNode(const std::chrono::milliseconds &t, handle &h, Args&&... args) {
+            return tryJoinNode(t, h, [](handle n) noexcept { registryType::shares(n) = 1; },
+                [](handle n) noexcept {
+                    if (!registryType::shares(n) || registryType::payload(n))
+                        return false;
+                    ++registryType::shares(n);
+                    return true;
+                },
+                std::forward<Args>(args)...);
+        }
+        // Leave a shared node, the last holder erases it and wakes the first waiter. then() runs while the lock is still held.
+        template <typename Then>
+        static void unshareNode(handle h, Then &&then) noexcept {
+            leaveNode(h, [&]() noexcept {
+                then();
+                return --registryType::shares(h) == 0;
+            });
+        }
+        static std::size_t size() noexcept {
+            return list.size();
+        }
+
+        // Like tryEmplace, but if the same condition exists w is parked (ret status::same) and w.wake is called
+        // once the holder releases it and it has been inserted for w. w.key and w.hash are filled here,
+        // w.node once inserted (ret status::ok or woken).
+        static status park(waiter<std::tuple<Conditions...>> &w, const std::tuple<Conditions...> &t, const std::chrono::milliseconds &timeout) {
+            w.key = std::addressof(t);
+            w.hash = hashOf(t);
+            status st = waiters.park(w, [&] {
+                handle h = nullptr;
+                status st = tryEmplaceKey(t, h, timeout);
+                w.node = h;
+                return st;
+            });
+            // Held outside the process, it is not released here.
+            if constexpr (requires { list.watch(t, &notify); })
+                if (st == status::same)
+                    list.watch(t, &notify);
+            return st;
+        }
+        // ret false if w was already woken (then the condition is held for it).
+        static bool unpark(waiter<std::tuple<Conditions...>> &w) noexcept {
+            return waiters.cancel(w);
+        }
+        // Check and insert all n conditions in one locked pass, nothing is inserted if any of them exists (or repeats).
+        // It takes the locks itself, t bounds taking all of them. The conditions are moved into the nodes, out[i] is the node of conditions[i].
+        static status tryEmplaceAll(std::chrono::milliseconds t, std::tuple<Conditions...> *conditions, std::size_t n, handle *out) {
+            lockSet<lockType> locks;
+            for (std::size_t i = 0; i < n; ++i) {
+                revoke(conditions[i]);
+                locks.add(list.lockFor(conditions[i]));
+            }
+            if (!admit(t))
+                return status::overload;
+            auto start = std::chrono::steady_clock::now();
+            if (!locks.tryLockUntil(start + t)) {
+                auto end = std::chrono::steady_clock::now();
+                settle(status::timeOut, end - start);
+                if constexpr (statsType::enabled)
+                    counters.acquire(status::timeOut, end - start, {});
+                return status::timeOut;
+            }
+            auto locked = std::chrono::steady_clock::now();
+            status st = status::ok;
+            for (std::size_t i = 0; i < n && st == status::ok; ++i) {
+                if (list.contains(conditions[i]))
+                    st = status::same;
+                for (std::size_t j = 0; j < i && st == status::ok; ++j)
+                    if (conditions[j] == conditions[i])
+                        st = status::same;
+            }
+            settle(st, locked - start);
+            if (st == status::ok) {
+                std::size_t i = 0;
+                try {
+                    for (; i < n; ++i)
+                        if (!(out[i] = list.insert(std::move(conditions[i]))))
+                            break;
+                } catch (...) {
+                    while (i)
+                        list.extract(out[--i]);
+                    throw;
+                }
+                // Refused by the registry (held by another process), nothing stays inserted.
+                if (i < n) {
+                    while (i)
+                        list.extract(out[--i]);
+                    st = status::same;
+                } else
+                    inserted(n);
+            }
+            if constexpr (statsType::enabled)
+                counters.acquire(st, locked - start, std::chrono::steady_clock::now() - locked);
+            return st;
+        }
+        // Release all n nodes in one locked pass (no lookups) and wake their waiters, then() runs first, while the locks are held.
+        template <typename Then>
+        static void releaseAll(const handle *nodes, std::size_t n, Then &&then) noexcept {
+            std::vector<typename registryType::extracted> gone;
+            {
+                lockSet<lockType> locks;
+                for (std::size_t i = 0; i < n; ++i)
+                    locks.add(list.lockFor(nodes[i]));
+                locks.lock();
+                then();
+                // A waiter that comes after this finds them erased once it gets the lock, nothing to wake or keep.
+                if (waiters.idle()) {
+                    for (std::size_t i = 0; i < n; ++i)
+                        list.extract(nodes[i]);
+                    erased(n);
+                    return;
+                }
+                gone.reserve(n);
+                for (std::size_t i = 0; i < n; ++i)
+                    gone.push_back(list.extract(nodes[i]));
+                erased(n);
+            }
+            for (auto &g : gone)
+                notify(g->key);
+        }
+        // Like tryEmplace, but if the same condition exists the caller blocks (on a semaphore, futex based) until it is
+        // released, only the release of this condition wakes it. t bounds the whole wait.
+        template <typename... Args>
+        static status waitEmplace(const std::chrono::milliseconds &t, const Args&... args) {
+            handle h;
+            return waitEmplaceNode(Opt::waitForRelease{}, t, h, args...);
+        }
+        // With the priority and deadline of o, see Opt::waitForRelease.
+        template <typename... Args>
+        static status waitEmplace(const Opt::waitForRelease &o, const std::chrono::milliseconds &t, const Args&... args) {
+            handle h;
+            return waitEmplaceNode(o, t, h, args...);
+        }
+        // Like waitEmplace, h is the node holding the conditions if inserted.
+        template <typename... Args>
+        static status waitEmplaceNode(const std::chrono::milliseconds &t, handle &h, Args&&... args) {
+            return waitEmplaceNode(Opt::waitForRelease{}, t, h, std::forward<Args>(args)...);
         }
         template <typename... Args>
-        static void erase(Args&&... args) noexcept {
-            list.erase(std::remove(list.begin(), list.end(), std::make_tuple(std::forward<Args...>(args...))), list.end());
+        static status waitEmplaceNode(const Opt::waitForRelease &o, std::chrono::milliseconds t, handle &h, Args&&... args) {
+            auto now = std::chrono::steady_clock::now();
+            auto deadline = now + t;
+            if (o.deadline < deadline) {
+                deadline = o.deadline;
+                t = std::max(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now), std::chrono::milliseconds(0));
+            }
+            auto k = view(std::forward<Args>(args)...);
+            if constexpr (affine)
+                if (reclaim(k, h))
+                    return status::ok;
+            status st = tryEmplaceKey(std::move(k), h, t);
+            if (st != status::same)
+                return st;
+            // Not inserted, so nothing was moved from args.
+            std::tuple<Conditions...> key(std::forward<Args>(args)...);
+            std::binary_semaphore granted(0);
+            waiter<std::tuple<Conditions...>> w;
+            w.priority = o.priority;
+            w.deadline = deadline;
+            w.self = &granted;
+            w.wake = [](void *self) noexcept { static_cast<std::binary_semaphore *>(self)->release(); };
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            st = park(w, key, std::max(left, std::chrono::milliseconds(0)));
+            if (st == status::same && !granted.try_acquire_until(deadline)) {
+                if (unpark(w))
+                    return status::timeOut;
+                // Woken in the meantime, wait until the waker is done with w.
+                granted.acquire();
+            }
+            h = static_cast<handle>(w.node);
+            // Parked and woken is held.
+            return st == status::same ? status::ok : st;
         }
-
-        static void erase(std::tuple<Conditions...> &&t) noexcept {
-            list.erase(std::remove(list.begin(), list.end(), t), list.end());
+        // Called after the condition has been erased and lockFor released, wakes the first waiter of it.
+        static void notify(const std::tuple<Conditions...> &t) noexcept {
+            waiters.notify(t, hashOf(t), [](waiter<std::tuple<Conditions...>> &w) {
+                std::lock_guard<lockType> guard(list.lockFor(*w.key));
+                try {
+                    w.node = list.contains(*w.key) ? nullptr : list.insert(*w.key);
+                } catch (...) {
+                    // No memory for the node, it stays parked until its time out.
+                    w.node = nullptr;
+                }
+                if (w.node)
+                    inserted(1);
+                return w.node != nullptr;
+            });
         }
     };
+    template <typename Registry, typename T, typename... Conditions>
+    padded<typename basicOneMethod<Registry, T, Conditions...>::registryType> basicOneMethod<Registry, T, Conditions...>::list;
+    template <typename Registry, typename T, typename... Conditions>
+    padded<waitQueue<std::tuple<Conditions...>>> basicOneMethod<Registry, T, Conditions...>::waiters;
+    template <typename Registry, typename T, typename... Conditions>
+    padded<typename basicOneMethod<Registry, T, Conditions...>::statsType> basicOneMethod<Registry, T, Conditions...>::counters;
+    template <typename Registry, typename T, typename... Conditions>
+    padded<typename basicOneMethod<Registry, T, Conditions...>::poolType> basicOneMethod<Registry, T, Conditions...>::pool;
+    template <typename Registry, typename T, typename... Conditions>
+    padded<typename basicOneMethod<Registry, T, Conditions...>::timeoutType> basicOneMethod<Registry, T, Conditions...>::timeouts;
+    template <typename Registry, typename T, typename... Conditions>
+    padded<typename basicOneMethod<Registry, T, Conditions...>::leaseTable> basicOneMethod<Registry, T, Conditions...>::leaseOwners;
+    template <typename Registry, typename T, typename... Conditions>
+    padded<typename basicOneMethod<Registry, T, Conditions...>::holderLists> basicOneMethod<Registry, T, Conditions...>::holderHeads;
+
     template <typename T, typename... Conditions>
-    std::vector<std::tuple<Conditions...>> oneMethod<T, Conditions...>::list;
+    using oneMethod = basicOneMethod<typename traitOr<registryMember, oneTraits<T, Conditions...>, defaultRegistry<Conditions...>>::type, T, Conditions...>;
+
     template <typename T, typename... Conditions>
-    std::timed_mutex oneMethod<T, Conditions...>::mtx;
+    class acquireAwaiter;
+
+    // throw the exception of st, if it is not status::ok
+    inline void raise(status st) {
+        switch (st) {
+        case status::same:
+            throw theSameException("There is the same");
+        case status::timeOut:
+            throw timeOutException("Get lock the time out");
+        case status::overload:
+            throw overloadException("Too many acquiring");
+        default:
+            break;
+        }
+    }
 
     /// @brief Construct a T type object using parameters and ensure that there is only one instance of T object with the same parameters
     // need args identical , e.g <std::string,std::string> and <std::string,std::string> ,Only then will this be effective (Otherwise it is a different instance)
@@ -100,54 +3020,128 @@ namespace one {
     };
     */
     /// @param Conditions... , If it's a pointer, the comparison will be based on the pointer address (including char*!), To compare whether strings are the same, std::string should be used
-    /// @param condition Condition generates one additional copy.
+    /// @param condition It is moved into the registry, the guard only keeps a handle to it (no other copy).
     template <typename T, typename... Conditions>
     class one : private oneMethod<T, Conditions...> {
         
     private:
-        std::tuple<Conditions...> data;
-        struct Base {
-            virtual inline T *get() = 0;
-            virtual ~Base() {}
-        };
-        Base *base;
-        struct retain : public Base {
-            T *ptr;
-            retain() {
-                ptr = new T();
-            };
-            template <typename... Args>
-            retain(Args&&... args) {
-                ptr = new T{args...};
+        typename oneMethod<T, Conditions...>::handle node = nullptr;
+        // The object is held in place (owned), or only the reference passed by the user. No heap allocation either way.
+        union {
+            T obj;
+        };
+        T *ptr = nullptr;
+        bool owned = false;
+        // Constructed using the condition (or taken back from the pool), so it can be kept by the pool.
+        bool recyclable = false;
+        // Opt::lazy: the object is constructed on first use. Set before the guard is shared, so the plain path reads it
+        // without synchronization.
+        bool lazy = false;
+        mutable onceStage built;
+        [[no_unique_address]] typename oneMethod<T, Conditions...>::stamp since;
+
+        // Construct the object in place after entrust, if it throws the condition is released again.
+        template <typename... Args>
+        inline void emplace(Args&&... args) {
+            try {
+                ::new (static_cast<void *>(std::addressof(obj))) T{std::forward<Args>(args)...};
+            } catch (...) {
+                release();
+                throw;
+            }
+            owned = true;
+            ptr = std::addressof(obj);
+        }
+        // Construct the object using the conditions in the node, or take back the one the pool keeps for them.
+        inline void emplaceCondition() {
+            if constexpr (oneMethod<T, Conditions...>::pooled) {
+                bool warm;
+                try {
+                    warm = this->recycle(this->conditionOf(node), static_cast<void *>(std::addressof(obj)));
+                } catch (...) {
+                    release();
+                    throw;
+                }
+                recyclable = true;
+                if (warm) {
+                    owned = true;
+                    ptr = std::addressof(obj);
+                    return;
+                }
             }
-            inline T *get() {
-                return ptr;
+            std::apply([this](const Conditions &...c) { emplace(c...); }, this->conditionOf(node));
+        }
+        inline void release() noexcept {
+            if constexpr (oneMethod<T, Conditions...>::pooled)
+                if (owned && recyclable)
+                    this->park(this->conditionOf(node), obj);
+            this->released(since);
+            this->releaseNode(node, [this]() noexcept {
+                if (owned)
+                    obj.~T();
+            });
+            node = nullptr;
+            owned = false;
+            recyclable = false;
+            ptr = nullptr;
+        }
+        // The object of Opt::lazy, constructed once by the first who asks; the others asking meanwhile wait for it.
+        // If the constructor throws, the condition is released and the exception passed to that asker, the later ones
+        // get nullptr.
+        inline T *construct() const {
+            if constexpr (requires(const Conditions &...c) { T{c...}; }) {
+                one *self = const_cast<one *>(this);
+                built.run([self] {
+                    if (self->node)
+                        self->emplaceCondition();
+                }, false);
             }
-            ~retain() {
-                delete ptr;
+            return ptr;
+        }
+        inline T *constructed() const noexcept {
+            try {
+                return construct();
+            } catch (...) {
+                return nullptr;
             }
-        };
-        struct package : public Base {
-            T &obj;
-            package(T &o) : obj(o){};
-            inline T *get() {
-                return &obj;
-            };
-        };
+        }
 
+        friend class acquireAwaiter<T, Conditions...>;
+        struct adopt {};
+        // The condition is already inserted for this guard (by a waiter), construct the object using condition.
+        one(adopt, typename oneMethod<T, Conditions...>::handle h) : node(h) {
+            this->acquired(since, &node);
+            emplaceCondition();
+        }
+
+        // The status of taking the condition, nothing is thrown for status::same or status::timeOut.
+        template <typename... Args>
+        inline status tryEntrust(const std::chrono::milliseconds &t, Args&&... condition) {
+            typename oneMethod<T, Conditions...>::handle h = nullptr;
+            status st = this->tryEmplaceNode(t, h, std::forward<Args>(condition)...);
+            if (st != status::ok)
+                return st;
+            node = h;
+            this->acquired(since, &node);
+            return st;
+        }
+        template <typename... Args>
+        inline status tryEntrustWait(const Opt::waitForRelease &w, const std::chrono::milliseconds &t, Args&&... condition) {
+            typename oneMethod<T, Conditions...>::handle h = nullptr;
+            status st = this->waitEmplaceNode(w, t, h, std::forward<Args>(condition)...);
+            if (st != status::ok)
+                return st;
+            node = h;
+            this->acquired(since, &node);
+            return st;
+        }
         template <typename... Args>
         inline void entrust(const std::chrono::milliseconds &t, Args&&... condition) {
-
-            // if need Guaranteed not to be modified during traversal ,Just get the lock first(Need Unlock before throwing)
-            if (this->verified(std::forward<Args...>(condition...)))
-                throw theSameException("There is the same");
-
-            if (!this->mtx.try_lock_for(t))
-                throw timeOutException("Get lock the time out");
-
-            this->add(std::forward<Args...>(condition...));
-            data = std::make_tuple(std::forward<Args...>(condition...));
-            this->mtx.unlock();
+            raise(tryEntrust(t, std::forward<Args>(condition)...));
+        }
+        template <typename... Args>
+        inline void entrustWait(const Opt::waitForRelease &w, const std::chrono::milliseconds &t, Args&&... condition) {
+            raise(tryEntrustWait(w, t, std::forward<Args>(condition)...));
         }
 
     public:
@@ -156,36 +3150,56 @@ namespace one {
         // Constructing objects using constructArgs.
         template <typename... Args>
         one(Conditions... condition, std::chrono::milliseconds t, Args&&... constructArgs) {
-            entrust(t, std::move(condition...));
-            base = new retain(constructArgs...);
+            entrust(t, std::move(condition)...);
+            emplace(std::forward<Args>(constructArgs)...);
         }
         // Constructing objects using constructArgs.
         template <typename... Args>
-        one(Conditions... condition, Args&&... constructArgs) : one(condition..., std::chrono::milliseconds(5000) , constructArgs...){};
+        one(Conditions... condition, Args&&... constructArgs) : one(std::move(condition)..., oneMethod<T, Conditions...>::defaultTimeOut , std::forward<Args>(constructArgs)...){};
 
         // Constructing objects using condition.
-        one(Conditions... condition, std::chrono::milliseconds t = std::chrono::milliseconds(5000)) {
-            entrust(t, std::move(condition...));
-            base = new retain(condition...);
+        one(Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrust(t, std::move(condition)...);
+            emplaceCondition();
         }
         /// @param o Indicates the use of the default constructor.
-        one(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = std::chrono::milliseconds(5000)) {
-            entrust(t, std::move(condition...));
-            base = new retain();
+        one(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrust(t, std::move(condition)...);
+            emplace();
+        }
+        // Constructing objects using condition, on the first use (see Opt::lazy).
+        one(const Opt::lazy &, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut)
+            requires requires(const Conditions &...c) { T{c...}; }
+        {
+            entrust(t, std::move(condition)...);
+            lazy = true;
+        }
+        // If the same condition already exists, wait for it to be released. If time out (get lock or wait) ,throw ex.
+        // Constructing objects using condition.
+        one(const Opt::waitForRelease &w, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrustWait(w, t, std::move(condition)...);
+            emplaceCondition();
+        }
+        // Constructing objects using constructArgs.
+        template <typename... Args>
+        one(const Opt::waitForRelease &w, Conditions... condition, std::chrono::milliseconds t, Args&&... constructArgs) {
+            entrustWait(w, t, std::move(condition)...);
+            emplace(std::forward<Args>(constructArgs)...);
         }
         // Passing reference wrappers for use after construction by the user.
         // For move semantics: right-value references should be passed directly as construction parameters; please select another constructor version.
         //  If the same condition already exists , or time out get lock ,throw ex.
-        one(T &d, Conditions... condition, std::chrono::milliseconds t = std::chrono::milliseconds(5000)) {
-            entrust(t, std::move(condition...));
-            base = new package(d);
+        one(T &d, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrust(t, std::move(condition)...);
+            ptr = std::addressof(d);
         }
         
-        inline bool init(Conditions... condition,std::chrono::milliseconds t = std::chrono::milliseconds(5000)){
+        inline bool init(Conditions... condition,std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut){
             try
             {
-                entrust(t,std::move(condition...));
-                base = new retain(condition...);
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                emplaceCondition();
                 return true;
             }
             catch(...)
@@ -199,8 +3213,9 @@ namespace one {
         template <typename... Args>
         inline bool init(Conditions... condition, std::chrono::milliseconds t, Args&&... constructArgs) noexcept {
             try {
-                entrust(t, std::move(condition...));
-                base = new retain(constructArgs...);
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                emplace(std::forward<Args>(constructArgs)...);
                 return true;
             } catch (...) {
                 return false;
@@ -210,51 +3225,124 @@ namespace one {
         // If the returns false, it can be called again until successful. There should be no resource leaks.
         template <typename... Args>
         inline bool init(Conditions... condition, Args &&...constructArgs)noexcept {
-            return init(condition..., std::chrono::milliseconds(5000), constructArgs...);
+            return init(condition..., oneMethod<T, Conditions...>::defaultTimeOut, std::forward<Args>(constructArgs)...);
         }
         // Passing reference wrappers for use after construction by the user.
         // For move semantics: right-value references should be passed directly as construction parameters; please select another constructor version.
         //  If the same condition already exists , or time out get lock ,throw ex.
         // If the returns false, it can be called again until successful. There should be no resource leaks.
-        inline bool init(T &d, Conditions... condition, std::chrono::milliseconds t = std::chrono::milliseconds(5000)) noexcept {
+        inline bool init(T &d, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) noexcept {
+            try {
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                ptr = std::addressof(d);
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+        // If the same condition already exists, wait for it to be released. If time out (get lock or wait) ,ret false.
+        template <typename... Args>
+        inline bool init(const Opt::waitForRelease &w, Conditions... condition, std::chrono::milliseconds t, Args&&... constructArgs) noexcept {
             try {
-                entrust(t, std::move(condition...));
-                base = new package(d);
+                if (tryEntrustWait(w, t, std::move(condition)...) != status::ok)
+                    return false;
+                if constexpr (sizeof...(Args) == 0)
+                    emplaceCondition();
+                else
+                    emplace(std::forward<Args>(constructArgs)...);
                 return true;
             } catch (...) {
                 return false;
             }
         }
+        inline bool init(const Opt::waitForRelease &w, Conditions... condition) noexcept {
+            return init(w, condition..., oneMethod<T, Conditions...>::defaultTimeOut);
+        }
         /// @param o Indicates the use of the default constructor.
         //// If the same condition already exists , or time out get lock ,ret false.
         // If the returns false, it can be called again until successful. There should be no resource leaks.
-        inline bool init(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = std::chrono::milliseconds(5000) ) noexcept {
+        inline bool init(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut ) noexcept {
+            try {
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                emplace();
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+        // Constructing objects using condition, on the first use (see Opt::lazy).
+        // If the same condition already exists , or time out get lock ,ret false.
+        inline bool init(const Opt::lazy &, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) noexcept
+            requires requires(const Conditions &...c) { T{c...}; }
+        {
             try {
-                entrust(t, std::move(condition...));
-                base = new retain();
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                lazy = true;
                 return true;
             } catch (...) {
                 return false;
             }
         }
 
+        // A probe that is told why it failed, e.g. by a scheduler: take the condition if it is free, and construct the object
+        // using condition (or constructArgs). No exception for a conflict or a time out, ret status::ok if held,
+        // status::same if the same condition already exists, status::timeOut if time out get lock, status::overload if too
+        // many are acquiring the type (adaptiveTimeOut).
+        // With lockFreeRegistry or boundedRegistry a conflict is a lookup, the lock is not taken.
+        // If the constructor of T throws, the condition is released again and the exception is passed on.
+        inline status tryAcquire(Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            status st = tryEntrust(t, std::move(condition)...);
+            if (st == status::ok)
+                emplaceCondition();
+            return st;
+        }
+        template <typename... Args>
+        inline status tryAcquire(Conditions... condition, std::chrono::milliseconds t, Args&&... constructArgs) {
+            status st = tryEntrust(t, std::move(condition)...);
+            if (st == status::ok)
+                emplace(std::forward<Args>(constructArgs)...);
+            return st;
+        }
+        // Constructing the object by default.
+        inline status tryAcquire(const Opt::notUseConditionConstructor &, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            status st = tryEntrust(t, std::move(condition)...);
+            if (st == status::ok)
+                emplace();
+            return st;
+        }
+
+        one(const one &) = delete;
+        one &operator=(const one &) = delete;
+
         ~one() noexcept {
-            this->mtx.lock();
-            this->erase(std::move(data));
-            delete base;
-            this->mtx.unlock();
+            if (node)
+                release();
         }
 
-        inline operator T &() noexcept {
-            return *base->get();
+        // The conditions held, they live in the registry node.
+        inline const std::tuple<Conditions...> &condition() const noexcept {
+            return this->conditionOf(node);
+        }
+
+        // With Opt::lazy, the exception of the constructor is thrown from here (once, later std::runtime_error).
+        inline operator T &() {
+            if (!lazy)
+                return *ptr;
+            if (T *p = construct())
+                return *p;
+            throw std::runtime_error("The lazy object could not be constructed");
         }
 
+        // With Opt::lazy, nullptr if the constructor throws.
         inline operator T *() const noexcept {
-            return base->get();
+            return lazy ? constructed() : ptr;
         }
 
         inline T *get() const noexcept {
-            return base->get();
+            return lazy ? constructed() : ptr;
         }
     };
 
@@ -263,37 +3351,64 @@ namespace one {
     // need args identical , e.g <std::string,std::string> and <std::string,std::string> ,Only then will this be effective (Otherwise it is a different instance)
     // if is Custom type, there should be T&& Construct 、operator == and operator &&== 、new not =delete
     /// @param Args... , If it's a pointer, the comparison will be based on the pointer address (including char*!), To compare whether strings are the same, std::string should be used
-    /// @param condition Condition generates one additional copy.
+    /// @param condition It is moved into the registry, the guard only keeps a handle to it (no other copy).
     template <typename T, typename... Conditions>
     struct oneR : private oneMethod<T, Conditions...> {
         T obj;
-        std::tuple<Conditions...> data;
+        // null until a condition is held.
+        typename oneMethod<T, Conditions...>::handle node = nullptr;
+        [[no_unique_address]] typename oneMethod<T, Conditions...>::stamp since;
+        // The status of taking the condition, nothing is thrown for status::same or status::timeOut.
+        template <typename... Args>
+        inline status tryEntrust(std::chrono::milliseconds t, Args&&... args) {
+            typename oneMethod<T, Conditions...>::handle h = nullptr;
+            status st = this->tryEmplaceNode(t, h, std::forward<Args>(args)...);
+            if (st != status::ok)
+                return st;
+            node = h;
+            this->acquired(since, &node);
+            return st;
+        }
+        template <typename... Args>
+        inline status tryEntrustWait(const Opt::waitForRelease &w, std::chrono::milliseconds t, Args&&... args) {
+            typename oneMethod<T, Conditions...>::handle h = nullptr;
+            status st = this->waitEmplaceNode(w, t, h, std::forward<Args>(args)...);
+            if (st != status::ok)
+                return st;
+            node = h;
+            this->acquired(since, &node);
+            return st;
+        }
         template <typename... Args>
         inline void entrust(std::chrono::milliseconds t, Args&&... args) {
-            // if need Guaranteed not to be modified during traversal ,Just get the lock first(Need Unlock before throwing)
-            if (this->verified(std::forward<Args...>(args...)))
-                throw theSameException("There is the same");
-
-            if (!this->mtx.try_lock_for(t))
-                throw timeOutException("Get lock the time out");
-
-            this->add(std::forward<Args...>(args...));
-            data = std::make_tuple(std::forward<Args...>(args...));
-            this->mtx.unlock();
+            raise(tryEntrust(t, std::forward<Args>(args)...));
+        }
+        template <typename... Args>
+        inline void entrustWait(const Opt::waitForRelease &w, std::chrono::milliseconds t, Args&&... args) {
+            raise(tryEntrustWait(w, t, std::forward<Args>(args)...));
+        }
+        // The conditions held, they live in the registry node.
+        inline const std::tuple<Conditions...> &condition() const noexcept {
+            return this->conditionOf(node);
         }
         oneR() noexcept {};
+        // If the same condition already exists, wait for it to be released. If time out (get lock or wait) ,throw ex.
+        template <typename... Args>
+        oneR(const Opt::waitForRelease &w, std::chrono::milliseconds t, Conditions... condition, Args&&... args) {
+            entrustWait(w, t, std::move(condition)...);
+            obj = T{args...};
+        }
         template <typename... Args>
         oneR(std::chrono::milliseconds t, Conditions... condition, Args&&... args) {
-            entrust(t, std::move(condition...));
+            entrust(t, std::move(condition)...);
             obj = T{args...};
         };
-        oneR(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = std::chrono::milliseconds(5000U)) {
-            entrust(t, std::move(condition...));
+        oneR(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrust(t, std::move(condition)...);
         }
-        inline bool init(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = std::chrono::milliseconds(5000U)) {
+        inline bool init(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
             try {
-                entrust(t, std::move(condition...));
-                return true;
+                return tryEntrust(t, std::move(condition)...) == status::ok;
             } catch (...) {
                 return false;
             }
@@ -301,24 +3416,544 @@ namespace one {
         template <typename... Args>
         inline bool init(std::chrono::milliseconds t, Conditions... condition, Args&&... args) noexcept {
             try {
-                entrust(t, std::move(condition...));
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                obj = T{args...};
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+        // If the same condition already exists, wait for it to be released. If time out (get lock or wait) ,ret false.
+        template <typename... Args>
+        inline bool init(const Opt::waitForRelease &w, std::chrono::milliseconds t, Conditions... condition, Args&&... args) noexcept {
+            try {
+                if (tryEntrustWait(w, t, std::move(condition)...) != status::ok)
+                    return false;
                 obj = T{args...};
                 return true;
             } catch (...) {
                 return false;
             }
         }
+        // Like init, but ret the status: status::ok if held, status::same or status::timeOut without an exception.
+        // If the constructor of T throws, the condition stays held by this guard (as with init) and the exception is passed on.
+        template <typename... Args>
+        inline status tryAcquire(std::chrono::milliseconds t, Conditions... condition, Args&&... args) {
+            status st = tryEntrust(t, std::move(condition)...);
+            if (st == status::ok)
+                obj = T{args...};
+            return st;
+        }
+        inline status tryAcquire(const Opt::notUseConditionConstructor &, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            return tryEntrust(t, std::move(condition)...);
+        }
         // After moving, the original member object should no longer be used.
         // And attention needs to be paid to the issue of object lifetimes (including the lifetimes of objects and lists).
         inline decltype(auto) move(){
             return std::move(obj);
         };
 
+        // Only what this guard acquired is released, a default constructed (or failed) one holds nothing.
         ~oneR() {
-            this->mtx.lock();
-            this->erase(std::move(data));
-            this->mtx.unlock();
+            if (!node)
+                return;
+            this->released(since);
+            this->releaseNode(node, []() noexcept {});
+        }
+    };
+
+    // Shared ownership of a condition, for resources that allow many readers (e.g. config files, mmap'd indexes):
+    // any number of oneShared with the same conditions are held at once, each with its own object.
+    // It shares the registry of one and oneR, which hold a condition exclusively: while readers hold it, one and oneR
+    // get the same (throw or ret false, or wait with Opt::waitForRelease until the last reader leaves), and while one
+    // of them holds it, readers get the same. New readers are not held back by a waiting writer.
+    template <typename T, typename... Conditions>
+    class oneShared : private oneMethod<T, Conditions...> {
+    private:
+        typename oneMethod<T, Conditions...>::handle node = nullptr;
+        union {
+            T obj;
+        };
+        bool owned = false;
+        [[no_unique_address]] typename oneMethod<T, Conditions...>::stamp since;
+
+        template <typename... Args>
+        inline void emplace(Args&&... args) {
+            try {
+                ::new (static_cast<void *>(std::addressof(obj))) T{std::forward<Args>(args)...};
+            } catch (...) {
+                release();
+                throw;
+            }
+            owned = true;
+        }
+        inline void emplaceCondition() {
+            std::apply([this](const Conditions &...c) { emplace(c...); }, this->conditionOf(node));
+        }
+        inline void release() noexcept {
+            this->released(since);
+            this->unshareNode(node, [this]() noexcept {
+                if (owned)
+                    obj.~T();
+            });
+            node = nullptr;
+            owned = false;
+        }
+        template <typename... Args>
+        inline status tryEntrust(const std::chrono::milliseconds &t, Args&&... condition) {
+            typename oneMethod<T, Conditions...>::handle h = nullptr;
+            status st = this->tryShareNode(t, h, std::forward<Args>(condition)...);
+            if (st != status::ok)
+                return st;
+            node = h;
+            this->acquired(since, &node);
+            return st;
+        }
+        template <typename... Args>
+        inline void entrust(const std::chrono::milliseconds &t, Args&&... condition) {
+            raise(tryEntrust(t, std::forward<Args>(condition)...));
+        }
+
+    public:
+        // The default constructor does nothing; if used, the init function should be called.
+        oneShared() noexcept {}
+        // Constructing objects using constructArgs.
+        // If a one or oneR holds the same condition , or time out get lock ,throw ex.
+        template <typename... Args>
+        oneShared(Conditions... condition, std::chrono::milliseconds t, Args&&... constructArgs) {
+            entrust(t, std::move(condition)...);
+            emplace(std::forward<Args>(constructArgs)...);
+        }
+        // Constructing objects using condition.
+        oneShared(Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrust(t, std::move(condition)...);
+            emplaceCondition();
+        }
+        /// @param o Indicates the use of the default constructor.
+        oneShared(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrust(t, std::move(condition)...);
+            emplace();
+        }
+
+        // If a one or oneR holds the same condition , or time out get lock ,ret false.
+        // If the returns false, it can be called again until successful. There should be no resource leaks.
+        inline bool init(Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) noexcept {
+            try {
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                emplaceCondition();
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+        template <typename... Args>
+        inline bool init(Conditions... condition, std::chrono::milliseconds t, Args&&... constructArgs) noexcept {
+            try {
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                emplace(std::forward<Args>(constructArgs)...);
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+        /// @param o Indicates the use of the default constructor.
+        inline bool init(const Opt::notUseConditionConstructor &o, Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) noexcept {
+            try {
+                if (tryEntrust(t, std::move(condition)...) != status::ok)
+                    return false;
+                emplace();
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+
+        // Like init, but ret the status: status::ok if shared, status::same if a one or oneR holds the same condition,
+        // status::timeOut if time out get lock, without an exception. If the constructor of T throws, it is passed on.
+        inline status tryAcquire(Conditions... condition, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            status st = tryEntrust(t, std::move(condition)...);
+            if (st == status::ok)
+                emplaceCondition();
+            return st;
+        }
+
+        oneShared(const oneShared &) = delete;
+        oneShared &operator=(const oneShared &) = delete;
+
+        ~oneShared() noexcept {
+            if (node)
+                release();
+        }
+
+        inline operator T &() noexcept {
+            return obj;
+        }
+        inline operator T *() noexcept {
+            return owned ? std::addressof(obj) : nullptr;
+        }
+        inline T *get() noexcept {
+            return owned ? std::addressof(obj) : nullptr;
+        }
+        // The conditions held, they live in the registry node.
+        inline const std::tuple<Conditions...> &condition() const noexcept {
+            return this->conditionOf(node);
+        }
+    };
+
+    // The single instance of T for some conditions with its count of sharedRef, held in the payload of the registry node.
+    template <typename T>
+    struct sharedInstance {
+        // Dropped to 0 only under the lock of the node, sharedGet joins under it too.
+        std::atomic<std::size_t> refs{1};
+        onceStage made;
+        bool constructed = false;
+        union {
+            T obj;
+        };
+        sharedInstance() noexcept {}
+        ~sharedInstance() {
+            if (constructed)
+                obj.~T();
+        }
+    };
+
+    // A counted reference to the instance of T shared by everyone asking for the same conditions, see sharedGet.
+    // Copies share it, the last one destroys it and releases the condition.
+    template <typename T, typename... Conditions>
+    class sharedRef {
+    private:
+        using method = oneMethod<T, Conditions...>;
+        typename method::handle node = nullptr;
+        sharedInstance<T> *inst = nullptr;
+
+        inline void release() noexcept {
+            if (!inst)
+                return;
+            // Not the last one, no lock needed.
+            for (std::size_t r = inst->refs.load(std::memory_order_relaxed); r > 1;)
+                if (inst->refs.compare_exchange_weak(r, r - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    inst = nullptr;
+                    return;
+                }
+            sharedInstance<T> *i = inst;
+            method::leaveNode(node, [i]() noexcept {
+                if (i->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    return false;
+                delete i;
+                return true;
+            });
+            inst = nullptr;
+            node = nullptr;
+        }
+
+    public:
+        // Empty, like after a move.
+        sharedRef() noexcept {}
+        // The instance of condition, it is constructed using condition by the first caller (the others wait for it).
+        // If a one, oneR or oneShared holds the same condition , or time out get lock ,throw ex. If the construction throws,
+        // the exception is passed on and the next caller tries again.
+        sharedRef(std::chrono::milliseconds t, Conditions... condition) {
+            raise(method::tryJoinNode(t, node,
+                [this](typename method::handle n) {
+                    inst = new sharedInstance<T>;
+                    method::payloadOf(n) = inst;
+                    method::sharesOf(n) = 1;
+                },
+                [this](typename method::handle n) noexcept {
+                    inst = static_cast<sharedInstance<T> *>(method::payloadOf(n));
+                    if (!inst)
+                        return false;
+                    inst->refs.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                },
+                std::move(condition)...));
+            try {
+                inst->made.run([this] {
+                    std::apply([this](const Conditions &...c) { ::new (static_cast<void *>(std::addressof(inst->obj))) T{c...}; }, method::conditionOf(node));
+                    inst->constructed = true;
+                }, true);
+            } catch (...) {
+                release();
+                throw;
+            }
+        }
+        sharedRef(const sharedRef &o) noexcept : node(o.node), inst(o.inst) {
+            if (inst)
+                inst->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        sharedRef(sharedRef &&o) noexcept : node(std::exchange(o.node, nullptr)), inst(std::exchange(o.inst, nullptr)) {}
+        sharedRef &operator=(sharedRef o) noexcept {
+            std::swap(node, o.node);
+            std::swap(inst, o.inst);
+            return *this;
+        }
+        ~sharedRef() noexcept {
+            release();
+        }
+
+        inline T *get() const noexcept {
+            return inst ? std::addressof(inst->obj) : nullptr;
+        }
+        inline T &operator*() const noexcept {
+            return inst->obj;
+        }
+        inline T *operator->() const noexcept {
+            return get();
+        }
+        inline explicit operator bool() const noexcept {
+            return inst != nullptr;
+        }
+        // The conditions held, they live in the registry node.
+        inline const std::tuple<Conditions...> &condition() const noexcept {
+            return method::conditionOf(node);
+        }
+    };
+
+    // Get-or-create: the one instance of T for condition, shared by every caller and destroyed when the last sharedRef
+    // to it goes away. T is constructed using condition, once, by the first caller.
+    // It shares the registry of one, so there is still only one T per condition: a one, oneR or oneShared holding it
+    // makes sharedGet throw the same exception, and they get the same while the instance exists.
+    template <typename T, typename... Conditions>
+    inline sharedRef<T, Conditions...> sharedGet(Conditions... condition) {
+        return sharedRef<T, Conditions...>(oneMethod<T, Conditions...>::defaultTimeOut, std::move(condition)...);
+    }
+    template <typename T, typename... Conditions>
+    inline sharedRef<T, Conditions...> sharedGet(std::chrono::milliseconds t, Conditions... condition) {
+        return sharedRef<T, Conditions...>(t, std::move(condition)...);
+    }
+
+    // A scope whose guards are released together: the one and oneR of T, Conditions... destroyed on this thread while it
+    // is alive (e.g. the guards of a batch job, or everything at shutdown) destroy their objects as usual but hand their
+    // conditions to it, and it releases all of them in one locked pass (each lock taken once) when it goes out of scope.
+    // Until then those conditions stay held, also for this thread. Groups nest, the innermost one collects.
+    /*
+    {
+        one::releaseGroup<std::fstream, std::string> group;
+        std::vector<std::unique_ptr<one::one<std::fstream, std::string>>> files = ...;
+        files.clear(); // the files are closed, their conditions released together below
+    }
+    */
+    template <typename T, typename... Conditions>
+    class releaseGroup : private oneMethod<T, Conditions...> {
+    private:
+        std::vector<typename oneMethod<T, Conditions...>::handle> nodes;
+        std::vector<typename oneMethod<T, Conditions...>::handle> *outer;
+
+    public:
+        releaseGroup() noexcept : outer(this->deferred()) {
+            this->deferred() = &nodes;
+        }
+        releaseGroup(const releaseGroup &) = delete;
+        releaseGroup &operator=(const releaseGroup &) = delete;
+        // On the thread that made it.
+        ~releaseGroup() {
+            this->deferred() = outer;
+            release();
+        }
+
+        // Release what was handed in so far, the group stays open.
+        inline void release() noexcept {
+            if (nodes.empty())
+                return;
+            this->releaseAll(nodes.data(), nodes.size(), []() noexcept {});
+            nodes.clear();
+        }
+        // Conditions handed in and not released yet.
+        inline std::size_t size() const noexcept {
+            return nodes.size();
+        }
+    };
+
+    // Hold several conditions together (e.g. the input, output and journal files of one job): all of them or none.
+    // They are checked and inserted in one locked pass, and released together in one pass.
+    template <typename T, typename... Conditions>
+    class multiOne : private oneMethod<T, Conditions...> {
+    private:
+        struct slot {
+            alignas(T) unsigned char bytes[sizeof(T)];
+        };
+        // The registry nodes of the conditions, in their order.
+        std::vector<typename oneMethod<T, Conditions...>::handle> nodes;
+        std::unique_ptr<slot[]> objs;
+        std::size_t constructed = 0;
+        [[no_unique_address]] typename oneMethod<T, Conditions...>::stamp since;
+
+        inline T *at(std::size_t i) const noexcept {
+            return std::launder(reinterpret_cast<T *>(objs[i].bytes));
+        }
+        inline void destroy() noexcept {
+            while (constructed)
+                at(--constructed)->~T();
+        }
+        inline void release() noexcept {
+            if (nodes.empty())
+                return;
+            this->released(since);
+            this->releaseAll(nodes.data(), nodes.size(), [this] { destroy(); });
+            nodes.clear();
+            objs.reset();
+        }
+        // If it throws, everything is released again. Nothing is thrown for status::same or status::timeOut.
+        template <typename Construct>
+        inline status tryEntrust(std::vector<std::tuple<Conditions...>> &&conditions, const std::chrono::milliseconds &t, Construct &&construct) {
+            std::vector<typename oneMethod<T, Conditions...>::handle> h(conditions.size());
+            status st = this->tryEmplaceAll(t, conditions.data(), conditions.size(), h.data());
+            if (st != status::ok)
+                return st;
+            nodes = std::move(h);
+            this->acquired(since, nodes.data(), nodes.size());
+            try {
+                objs.reset(new slot[nodes.size()]);
+                for (; constructed < nodes.size(); ++constructed)
+                    construct(static_cast<void *>(objs[constructed].bytes), this->conditionOf(nodes[constructed]));
+            } catch (...) {
+                release();
+                throw;
+            }
+            return status::ok;
+        }
+        template <typename Construct>
+        inline void entrust(std::vector<std::tuple<Conditions...>> &&conditions, const std::chrono::milliseconds &t, Construct &&construct) {
+            raise(tryEntrust(std::move(conditions), t, std::forward<Construct>(construct)));
+        }
+        static inline void fromCondition(void *p, const std::tuple<Conditions...> &c) {
+            std::apply([p](const Conditions &...c) { ::new (p) T{c...}; }, c);
+        }
+        static inline void byDefault(void *p, const std::tuple<Conditions...> &) {
+            ::new (p) T();
+        }
+
+    public:
+        // The default constructor does nothing; if used, the init function should be called.
+        multiOne() noexcept {}
+        // Constructing objects using each condition.
+        // e.g one::multiOne<std::fstream, std::string> job({"in.txt", "out.txt", "journal.txt"});
+        // If any of the same conditions already exists , or time out get lock ,throw ex. None of them is held then.
+        multiOne(std::vector<std::tuple<Conditions...>> conditions, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrust(std::move(conditions), t, &fromCondition);
+        }
+        /// @param o Indicates the use of the default constructor.
+        multiOne(const Opt::notUseConditionConstructor &o, std::vector<std::tuple<Conditions...>> conditions, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) {
+            entrust(std::move(conditions), t, &byDefault);
+        }
+        multiOne(const multiOne &) = delete;
+        multiOne &operator=(const multiOne &) = delete;
+
+        // If any of the same conditions already exists , or time out get lock ,ret false, none of them is held.
+        // If the returns false, it can be called again until successful. There should be no resource leaks.
+        inline bool init(std::vector<std::tuple<Conditions...>> conditions, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) noexcept {
+            try {
+                if (tryEntrust(std::move(conditions), t, &fromCondition) != status::ok)
+                    return false;
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+        inline bool init(const Opt::notUseConditionConstructor &o, std::vector<std::tuple<Conditions...>> conditions, std::chrono::milliseconds t = oneMethod<T, Conditions...>::defaultTimeOut) noexcept {
+            try {
+                if (tryEntrust(std::move(conditions), t, &byDefault) != status::ok)
+                    return false;
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+
+        ~multiOne() noexcept {
+            release();
+        }
+
+        // In the order of the conditions.
+        inline T *get(std::size_t i) const noexcept {
+            return at(i);
+        }
+        inline T &operator[](std::size_t i) noexcept {
+            return *at(i);
+        }
+        inline std::size_t size() const noexcept {
+            return constructed;
+        }
+    };
+
+    // co_await one::acquire<T, Conditions...>(condition...)
+    // If the same condition exists, the coroutine is suspended (no thread is blocked) and resumed from the destructor of its holder.
+    template <typename T, typename... Conditions>
+    class acquireAwaiter {
+    private:
+        using method = oneMethod<T, Conditions...>;
+        std::tuple<Conditions...> key;
+        typename method::handle node = nullptr;
+        std::chrono::milliseconds t;
+        status st = status::same;
+        bool parked = false;
+        waiter<std::tuple<Conditions...>> w;
+        std::coroutine_handle<> handle;
+
+        static void wake(void *self) noexcept {
+            auto *a = static_cast<acquireAwaiter *>(self);
+            a->parked = false;
+            a->st = status::ok;
+            a->node = static_cast<typename method::handle>(a->w.node);
+            a->handle.resume();
+        }
+
+    public:
+        acquireAwaiter(std::chrono::milliseconds t, Conditions... condition) : key(std::move(condition)...), t(t) {}
+        // A suspended coroutine is only resumed by a grant, so only the priority of o is used.
+        acquireAwaiter(const Opt::waitForRelease &o, std::chrono::milliseconds t, Conditions... condition) : acquireAwaiter(t, std::move(condition)...) {
+            w.priority = o.priority;
+        }
+        acquireAwaiter(const acquireAwaiter &) = delete;
+        acquireAwaiter &operator=(const acquireAwaiter &) = delete;
+        // A coroutine destroyed while it is suspended leaves the queue.
+        ~acquireAwaiter() {
+            if (parked)
+                method::unpark(w);
+        }
+
+        // The conditions are moved into the registry if inserted here, otherwise key is kept for parking.
+        inline bool await_ready() {
+            st = std::apply([this](Conditions &...c) { return method::tryEmplaceNode(t, node, std::move(c)...); }, key);
+            return st != status::same;
+        }
+        inline bool await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            w.self = this;
+            w.wake = &wake;
+            parked = true;
+            status r = method::park(w, key, t);
+            // Parked, it may already be resumed on another thread, do not touch this anymore.
+            if (r == status::same)
+                return true;
+            parked = false;
+            st = r;
+            node = static_cast<typename method::handle>(w.node);
+            return false;
+        }
+        // If time out get lock ,throw ex.
+        inline one<T, Conditions...> await_resume() {
+            raise(st);
+            return one<T, Conditions...>(typename one<T, Conditions...>::adopt{}, node);
         }
     };
 
+    // The object is constructed using condition once the condition is acquired.
+    template <typename T, typename... Conditions>
+    inline acquireAwaiter<T, Conditions...> acquire(Conditions... condition) {
+        return acquireAwaiter<T, Conditions...>(oneMethod<T, Conditions...>::defaultTimeOut, std::move(condition)...);
+    }
+    template <typename T, typename... Conditions>
+    inline acquireAwaiter<T, Conditions...> acquire(std::chrono::milliseconds t, Conditions... condition) {
+        return acquireAwaiter<T, Conditions...>(t, std::move(condition)...);
+    }
+    // Granted before the waiters of a lower o.priority.
+    template <typename T, typename... Conditions>
+    inline acquireAwaiter<T, Conditions...> acquire(const Opt::waitForRelease &o, std::chrono::milliseconds t, Conditions... condition) {
+        return acquireAwaiter<T, Conditions...>(o, t, std::move(condition)...);
+    }
+
 } // namespace one
@@ -0,0 +1,269 @@
+    // one_lease.hpp
+    // Lang c++20
+    // Version 0.0.2
+    // https://github.com/moehoshio/one.h
+    // MIT License
+    // A registry of one.hpp held through leases of a coordination service (etcd, Consul, ZooKeeper, Redis ...),
+    // so a condition is held by one node of a cluster at a time. The client of the service is yours, see leaseRegistry.
+
+/*
+MIT License
+Copyright (c) 2024 Hoshi
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "one.hpp"
+
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+
+namespace one {
+
+    // The lease of a process and the keys held under it, for every registry using Client with the same TTL.
+    // A single lease covers all the held keys, so one renewal (Client::keepAlive, every TTL / 3 by one thread)
+    // keeps any number of guards, instead of a heartbeat per guard.
+    // If the lease can not be renewed within its TTL it is lost: the service frees its keys, token() of them is 0,
+    // and new claims get a new lease. The guards still exist, pass their token to the resource (fencing) so it
+    // can reject a holder that lost its lease.
+    template <typename Client, std::size_t TTL>
+    class leaseSession {
+    private:
+        struct held {
+            std::uint64_t token;
+            std::uint64_t lease;
+        };
+        static constexpr std::chrono::milliseconds ttl{TTL};
+
+        Client service;
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::uint64_t lease = 0;
+        std::chrono::steady_clock::time_point renewed;
+        std::unordered_map<std::string, held> keys;
+        std::thread renewer;
+        bool stop = false;
+
+        inline bool live() const noexcept {
+            return lease != 0 && std::chrono::steady_clock::now() - renewed < ttl;
+        }
+        // The live lease, granted if there is none. The caller holds mtx.
+        inline std::uint64_t current(std::unique_lock<std::mutex> &guard) {
+            if (live())
+                return lease;
+            guard.unlock();
+            auto at = std::chrono::steady_clock::now();
+            std::uint64_t id = service.grant(ttl);
+            guard.lock();
+            // Another thread may have granted one meanwhile, the later one is unused and expires.
+            if (!live()) {
+                lease = id;
+                renewed = at;
+            }
+            if (!renewer.joinable())
+                renewer = std::thread([this] { renew(); });
+            return lease;
+        }
+        inline void renew() {
+            std::unique_lock<std::mutex> guard(mtx);
+            auto every = ttl / 3;
+            while (!stop) {
+                wake.wait_for(guard, every);
+                if (stop || keys.empty() || !lease)
+                    continue;
+                std::uint64_t id = lease;
+                auto at = std::chrono::steady_clock::now();
+                guard.unlock();
+                bool ok;
+                try {
+                    ok = service.keepAlive(id);
+                } catch (...) {
+                    ok = false;
+                }
+                guard.lock();
+                if (id != lease)
+                    continue;
+                if (ok) {
+                    renewed = at;
+                    every = ttl / 3;
+                } else if (!live())
+                    lease = 0;
+                else
+                    // Retry sooner while it is not expired yet.
+                    every = ttl / 10;
+            }
+        }
+
+        leaseSession() = default;
+
+    public:
+        leaseSession(const leaseSession &) = delete;
+        leaseSession &operator=(const leaseSession &) = delete;
+        ~leaseSession() {
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                stop = true;
+            }
+            wake.notify_all();
+            if (renewer.joinable())
+                renewer.join();
+        }
+
+        static inline leaseSession &instance() {
+            static leaseSession session;
+            return session;
+        }
+        inline Client &client() noexcept {
+            return service;
+        }
+        // Hold key under the lease, ret false if another holder has it.
+        inline bool claim(const std::string &key) {
+            std::unique_lock<std::mutex> guard(mtx);
+            std::uint64_t id = current(guard);
+            guard.unlock();
+            std::uint64_t token = service.acquire(key, id);
+            if (!token)
+                return false;
+            guard.lock();
+            keys[key] = held{token, id};
+            return true;
+        }
+        inline void release(const std::string &key) noexcept {
+            std::uint64_t id;
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                auto it = keys.find(key);
+                if (it == keys.end())
+                    return;
+                id = it->second.lease;
+                keys.erase(it);
+            }
+            try {
+                service.release(key, id);
+            } catch (...) {
+                // Freed by the service once the lease expires.
+            }
+        }
+        // The fencing token of key, 0 if it is not held under the live lease.
+        inline std::uint64_t token(const std::string &key) noexcept {
+            std::lock_guard<std::mutex> guard(mtx);
+            auto it = keys.find(key);
+            if (it == keys.end() || it->second.lease != lease || !live())
+                return 0;
+            return it->second.token;
+        }
+    };
+
+    // The key of the conditions in the service: Prefix followed by their bytes (conditionBytes, binary).
+    template <typename Key, typename Q>
+    inline std::string leaseKey(const char *prefix, const Q &q) {
+        struct out {
+            std::string s;
+            inline void append(const void *p, std::size_t n) {
+                s.append(static_cast<const char *>(p), n);
+            }
+        } k{prefix};
+        conditionBytes<Key>(q, k);
+        return std::move(k.s);
+    }
+
+    // The backend of backedStorage through leaseSession<Client, TTL>.
+    template <typename Key, typename Client, registryName Prefix, std::size_t TTL>
+    class leaseBackend {
+    private:
+        using session = leaseSession<Client, TTL>;
+
+    public:
+        template <typename Q>
+        inline bool claim(const Q &k) {
+            return session::instance().claim(leaseKey<Key>(Prefix.value, k));
+        }
+        template <typename Q>
+        inline void release(const Q &k) noexcept {
+            try {
+                session::instance().release(leaseKey<Key>(Prefix.value, k));
+            } catch (...) {
+                // No memory for the key, it is freed by the service once the lease expires.
+            }
+        }
+        // If the service can not be asked, it is reported held.
+        template <typename Q>
+        inline bool held(const Q &k) noexcept {
+            try {
+                return session::instance().client().held(leaseKey<Key>(Prefix.value, k));
+            } catch (...) {
+                return true;
+            }
+        }
+        template <typename Wake>
+        inline void watch(const Key &k, Wake wake)
+            requires requires(Client &c) { c.watch(std::string_view{}, std::function<void()>{}); }
+        {
+            try {
+                session::instance().client().watch(leaseKey<Key>(Prefix.value, k), [k, wake] { wake(k); });
+            } catch (...) {
+                // Not watched, the waiter waits out its time out.
+            }
+        }
+    };
+
+    // A registry held through the leases of Client (TTL in milliseconds), e.g. a wrapper of an etcd connection.
+    // Every key is Prefix followed by the bytes of the conditions, use the same Prefix for the types whose
+    // conditions should exclude each other across nodes. Client is default constructed once, it is called from
+    // several threads at once (the renewal thread and the guards), and should have:
+    /*
+    struct client {
+        // A new lease of ttl, its id (not 0).
+        std::uint64_t grant(std::chrono::milliseconds ttl);
+        // Renew the lease and so every key under it, ret false if it has expired.
+        bool keepAlive(std::uint64_t lease);
+        // Create key under lease if it does not exist, ret its fencing token (not 0, larger for every create,
+        // e.g. the etcd create revision), or 0 if it exists.
+        std::uint64_t acquire(std::string_view key, std::uint64_t lease);
+        // Delete key if it is under lease.
+        void release(std::string_view key, std::uint64_t lease);
+        // Whether key exists.
+        bool held(std::string_view key);
+        // Optional: call done() once, after key is deleted (soon if it does not exist), so waiters are woken by
+        // other nodes' releases. Without it they wait out their time out.
+        void watch(std::string_view key, std::function<void()> done);
+    };
+    */
+    // Calls of the service are made under the lock of the registry of a type, so its acquisitions wait for each other.
+    template <typename Client, registryName Prefix, std::size_t TTL = 10000>
+    struct leaseRegistry {
+        template <typename Key, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+        using type = backedStorage<Key, leaseBackend<Key, Client, Prefix, TTL>, tupleHash<Key>, Alloc, Lock>;
+
+        // The fencing token of conditions held by this process, e.g. leaseRegistry<...>::token(file.condition()).
+        // 0 if they are not held here, or the lease was lost.
+        template <typename... Conditions>
+        static inline std::uint64_t token(const std::tuple<Conditions...> &conditions) noexcept {
+            try {
+                return leaseSession<Client, TTL>::instance().token(leaseKey<std::tuple<Conditions...>>(Prefix.value, conditions));
+            } catch (...) {
+                return 0;
+            }
+        }
+    };
+
+} // namespace one
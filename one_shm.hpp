@@ -0,0 +1,344 @@
+    // one_shm.hpp
+    // Lang c++20
+    // Version 0.0.2
+    // https://github.com/moehoshio/one.h
+    // MIT License
+    // A registry of one.hpp shared by the processes of a host, in a named POSIX shared memory segment.
+    // POSIX only (robust process-shared mutexes, e.g. Linux or FreeBSD; not macOS), link with -lrt on glibc older than 2.34.
+
+/*
+MIT License
+Copyright (c) 2024 Hoshi
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "one.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace one {
+
+    // The bytes of the conditions (conditionBytes), what the processes compare. Keys longer than shmKeyBytes are
+    // compared by their length, the first shmKeyBytes bytes and a 64-bit hash of all of them.
+    inline constexpr std::size_t shmKeyBytes = 232;
+    struct shmKey {
+        // FNV-1a, the same in every process (std::hash may differ between builds).
+        std::uint64_t hash = 14695981039346656037ull;
+        std::uint32_t size = 0;
+        unsigned char bytes[shmKeyBytes];
+
+        inline void append(const void *p, std::size_t n) noexcept {
+            const unsigned char *b = static_cast<const unsigned char *>(p);
+            for (std::size_t i = 0; i < n; ++i, ++size) {
+                if (size < shmKeyBytes)
+                    bytes[size] = b[i];
+                hash = (hash ^ b[i]) * 1099511628211ull;
+            }
+        }
+    };
+
+    template <typename Key, typename Q>
+    inline shmKey shmEncode(const Q &q) noexcept {
+        shmKey k;
+        conditionBytes<Key>(q, k);
+        return k;
+    }
+
+    // A named segment: an open addressing table of the held conditions with the process holding each, under one
+    // robust process-shared mutex. It is created by the first process that opens it and never unlinked here,
+    // remove it with shm_unlink (or rm /dev/shm/name) once no process uses it, e.g. to change its capacity.
+    // Dead owners are recovered: if a process dies holding the mutex, the next one takes it over (every write
+    // leaves the table consistent); the conditions held by a dead process are free again once someone asks for them.
+    // The creator gives it mode (less the umask): whoever can write it can take or drop any condition of the registry.
+    class shmSegment {
+    public:
+        struct slot {
+            std::uint64_t hash;
+            std::uint32_t state; // empty, used or erased
+            std::int32_t pid;
+            // Tells this process from an earlier one with the same pid (e.g. after exec).
+            std::uint32_t incarnation;
+            std::uint32_t size;
+            unsigned char bytes[shmKeyBytes];
+        };
+        struct header {
+            std::uint32_t magic;
+            std::uint32_t capacity;
+            std::uint32_t slotSize;
+            std::atomic<std::uint32_t> ready;
+            pthread_mutex_t lock;
+        };
+
+    private:
+        static constexpr std::uint32_t magicValue = 0x6f6e6531; // "one1"
+        enum : std::uint32_t { empty = 0, used = 1, erased = 2 };
+
+        const char *name;
+        std::size_t capacity;
+        mode_t mode;
+        onceStage opened;
+        header *head = nullptr;
+        slot *slots = nullptr;
+
+        static inline std::size_t bytesFor(std::size_t capacity) noexcept {
+            return (sizeof(header) + 63) / 64 * 64 + capacity * sizeof(slot);
+        }
+        static inline std::uint32_t incarnation() noexcept {
+            static const std::uint32_t self = static_cast<std::uint32_t>(
+                std::chrono::steady_clock::now().time_since_epoch().count() ^ std::chrono::system_clock::now().time_since_epoch().count());
+            return self;
+        }
+        static inline bool alive(const slot &s) noexcept {
+            if (s.pid == getpid())
+                return s.incarnation == incarnation();
+            return kill(s.pid, 0) == 0 || errno == EPERM;
+        }
+        static inline bool same(const slot &s, const shmKey &k) noexcept {
+            return s.hash == k.hash && s.size == k.size && std::memcmp(s.bytes, k.bytes, std::min<std::size_t>(k.size, shmKeyBytes)) == 0;
+        }
+        static inline void waitFor(const std::chrono::steady_clock::time_point &deadline, const char *what, const char *name) {
+            if (std::chrono::steady_clock::now() > deadline)
+                throw std::runtime_error(std::string("one: ") + what + " of shared registry " + name);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        inline void create(int fd) {
+            std::size_t bytes = bytesFor(capacity);
+            if (ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+                throw std::system_error(errno, std::generic_category(), "one: ftruncate");
+            map(fd, bytes);
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+            int r = pthread_mutex_init(&head->lock, &attr);
+            pthread_mutexattr_destroy(&attr);
+            if (r != 0)
+                throw std::system_error(r, std::generic_category(), "one: pthread_mutex_init");
+            head->magic = magicValue;
+            head->capacity = static_cast<std::uint32_t>(capacity);
+            head->slotSize = sizeof(slot);
+            head->ready.store(1, std::memory_order_release);
+        }
+        // Wait until the creator has sized and initialized it.
+        inline void attach(int fd) {
+            std::size_t bytes = bytesFor(capacity);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            struct stat st{};
+            while (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < bytes) {
+                if (st.st_size > 0 && static_cast<std::size_t>(st.st_size) != bytes)
+                    throw std::runtime_error(std::string("one: shared registry ") + name + " has another capacity");
+                waitFor(deadline, "no creator", name);
+            }
+            map(fd, bytes);
+            while (head->ready.load(std::memory_order_acquire) != 1)
+                waitFor(deadline, "no creator", name);
+            if (head->magic != magicValue || head->capacity != capacity || head->slotSize != sizeof(slot))
+                throw std::runtime_error(std::string("one: shared registry ") + name + " has another layout");
+        }
+        inline void map(int fd, std::size_t bytes) {
+            void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED)
+                throw std::system_error(errno, std::generic_category(), "one: mmap");
+            head = static_cast<header *>(p);
+            slots = reinterpret_cast<slot *>(static_cast<char *>(p) + (sizeof(header) + 63) / 64 * 64);
+        }
+        inline void open() {
+            opened.run([this] {
+                int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, mode);
+                bool creator = fd >= 0;
+                if (!creator && errno == EEXIST)
+                    fd = shm_open(name, O_RDWR, 0);
+                if (fd < 0)
+                    throw std::system_error(errno, std::generic_category(), std::string("one: shm_open ") + name);
+                try {
+                    creator ? create(fd) : attach(fd);
+                } catch (...) {
+                    close(fd);
+                    throw;
+                }
+                close(fd);
+            }, true);
+        }
+
+        // The mutex of the table, taken over if its owner died.
+        class locked {
+        private:
+            pthread_mutex_t *m;
+
+        public:
+            explicit locked(header *h) noexcept : m(&h->lock) {
+                if (pthread_mutex_lock(m) == EOWNERDEAD)
+                    pthread_mutex_consistent(m);
+            }
+            locked(const locked &) = delete;
+            locked &operator=(const locked &) = delete;
+            ~locked() {
+                pthread_mutex_unlock(m);
+            }
+        };
+
+        // The slot of k, or nullptr; free is the first slot k can be inserted at (nullptr if the table is full).
+        inline slot *find(const shmKey &k, slot *&free) noexcept {
+            std::size_t mask = capacity - 1;
+            free = nullptr;
+            for (std::size_t i = k.hash & mask, n = 0; n < capacity; i = (i + 1) & mask, ++n) {
+                slot &s = slots[i];
+                if (s.state == empty) {
+                    if (!free)
+                        free = &s;
+                    return nullptr;
+                }
+                if (s.state == used && same(s, k))
+                    return &s;
+                if (s.state == erased && !free)
+                    free = &s;
+            }
+            return nullptr;
+        }
+        // Mark s erased, and empty with the erased ones before it if nothing is probed past it.
+        inline void drop(slot *s) noexcept {
+            std::size_t mask = capacity - 1;
+            std::size_t i = static_cast<std::size_t>(s - slots);
+            s->state = erased;
+            if (slots[(i + 1) & mask].state != empty)
+                return;
+            for (std::size_t n = 0; n < capacity && slots[i].state == erased; i = (i - 1) & mask, ++n)
+                slots[i].state = empty;
+        }
+
+    public:
+        shmSegment(const char *name, std::size_t capacity, mode_t mode = 0600) noexcept : name(name), capacity(capacity), mode(mode) {}
+        shmSegment(const shmSegment &) = delete;
+        shmSegment &operator=(const shmSegment &) = delete;
+        ~shmSegment() {
+            if (head)
+                munmap(head, bytesFor(capacity));
+        }
+
+        // Hold k for this process, ret false if a live process holds it.
+        inline bool claim(const shmKey &k) {
+            open();
+            locked guard(head);
+            slot *free;
+            slot *s = find(k, free);
+            if (s) {
+                if (alive(*s))
+                    return false;
+                // Its holder died, take it over.
+            } else {
+                if (!free)
+                    throw std::length_error(std::string("one: shared registry ") + name + " is full");
+                s = free;
+                s->hash = k.hash;
+                s->size = k.size;
+                std::memcpy(s->bytes, k.bytes, std::min<std::size_t>(k.size, shmKeyBytes));
+            }
+            s->pid = getpid();
+            s->incarnation = incarnation();
+            // Last, a process dying before this leaves the slot free.
+            s->state = used;
+            return true;
+        }
+        // Release k if this process holds it.
+        inline void release(const shmKey &k) noexcept {
+            if (!head)
+                return;
+            locked guard(head);
+            slot *free;
+            slot *s = find(k, free);
+            if (s && s->pid == getpid() && s->incarnation == incarnation())
+                drop(s);
+        }
+        // Whether a live process (this one included) holds k.
+        inline bool held(const shmKey &k) {
+            open();
+            locked guard(head);
+            slot *free;
+            slot *s = find(k, free);
+            if (!s)
+                return false;
+            if (alive(*s))
+                return true;
+            drop(s);
+            return false;
+        }
+    };
+
+    // The backend of backedStorage in the segment Name.
+    template <typename Key, registryName Name, std::size_t Capacity, mode_t Mode>
+    class shmBackend {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity should be a power of two");
+
+    private:
+        shmSegment segment{Name.value, Capacity, Mode};
+
+    public:
+        template <typename Q>
+        inline bool claim(const Q &k) {
+            return segment.claim(shmEncode<Key>(k));
+        }
+        template <typename Q>
+        inline void release(const Q &k) noexcept {
+            segment.release(shmEncode<Key>(k));
+        }
+        // If the segment can not be opened, it is reported held.
+        template <typename Q>
+        inline bool held(const Q &k) noexcept {
+            try {
+                return segment.held(shmEncode<Key>(k));
+            } catch (...) {
+                return true;
+            }
+        }
+    };
+
+    // A registry shared by the processes of the host, through the segment Name (e.g. "/myapp.files") of Capacity
+    // conditions (a power of two). Use the same Name for the types whose conditions should exclude each other
+    // across processes (e.g. every type opening files by path), and the same Capacity in every process.
+    // Mode is given to the segment by the process creating it: only its user by default, e.g. 0660 for the processes of
+    // a group (the segment is then of the group of the creator).
+    /*
+    template <>
+    struct one::oneTraits<std::fstream, std::string> {
+        using registry = shmRegistry<"/myapp.files">;
+    };
+    */
+    // The conditions need a conditionCodec (integers, enums and strings have one). A caller waiting for a condition
+    // (Opt::waitForRelease, acquire) is woken by releases in its own process, for another process it waits out its time out.
+    template <registryName Name, std::size_t Capacity = 4096, mode_t Mode = 0600>
+    struct shmRegistry {
+        template <typename Key, typename Alloc = heapAllocator, typename Lock = std::timed_mutex>
+        using type = backedStorage<Key, shmBackend<Key, Name, Capacity, Mode>, tupleHash<Key>, Alloc, Lock>;
+    };
+
+} // namespace one
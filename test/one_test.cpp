@@ -0,0 +1,135 @@
+// one_test.cpp
+// Regression tests of one.hpp, each case asserts and a failing case aborts.
+// Build: g++ -std=c++20 -O1 -pthread -I.. one_test.cpp -o one_test
+// Run:   ./one_test
+
+#undef NDEBUG
+#include "one.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace test {
+    using namespace std::chrono_literals;
+
+    // A type per case, so each has a registry of its own.
+    template <int Case>
+    struct obj {
+        int v = 0;
+        obj() = default;
+        explicit obj(int c) : v(c) {}
+    };
+
+    // A failed init / tryAcquire on a guard that already holds a condition keeps it, the destructor releases it.
+    template <typename Guard, typename... Try>
+    void keepsHeld(Try &&...tryAgain) {
+        using method = one::oneMethod<typename Guard::type, int>;
+        {
+            Guard a(one::Opt::notUseConditionConstructor{}, 1);
+            Guard b(one::Opt::notUseConditionConstructor{}, 2);
+            (tryAgain(a), ...);
+            assert(method::size() == 2);
+        }
+        assert(method::size() == 0);
+        assert(!method::verified(1) && !method::verified(2));
+        Guard again(one::Opt::notUseConditionConstructor{}, 1);
+        assert(method::verified(1));
+    }
+    template <typename T>
+    struct oneGuard : one::one<T, int> {
+        using type = T;
+        using one::one<T, int>::one;
+    };
+    template <typename T>
+    struct oneRGuard : one::oneR<T, int> {
+        using type = T;
+        using one::oneR<T, int>::oneR;
+    };
+
+    void failedRetry() {
+        keepsHeld<oneGuard<obj<0>>>([](auto &g) { assert(!g.init(2, 1ms)); });
+        keepsHeld<oneGuard<obj<1>>>([](auto &g) { assert(g.tryAcquire(2, 1ms) == one::status::same); });
+        keepsHeld<oneGuard<obj<2>>>([](auto &g) { assert(!g.init(one::Opt::waitForRelease{}, 2, 1ms)); });
+        keepsHeld<oneRGuard<obj<3>>>([](auto &g) { assert(!g.init(1ms, 2)); });
+        keepsHeld<oneRGuard<obj<4>>>([](auto &g) { assert(g.tryAcquire(one::Opt::notUseConditionConstructor{}, 2, 1ms) == one::status::same); });
+    }
+
+    // erase of a condition that is not held releases nothing.
+    struct counted {};
+} // namespace test
+template <>
+struct one::oneTraits<test::counted, int> {
+    using stats = basicStats;
+};
+namespace test {
+    void eraseMiss() {
+        using method = one::oneMethod<counted, int>;
+        assert(method::tryEmplace(1ms, std::tuple<int>(1)) == one::status::ok);
+        method::erase(2);
+        assert(method::statistics().releases == 0 && method::statistics().size == 1);
+        method::erase(1);
+        method::erase(1);
+        assert(method::statistics().releases == 1 && method::statistics().size == 0);
+    }
+
+    // sharedGet while the instance is built: if the constructor throws, its caller gets the exception and the one waiting
+    // builds it again.
+    struct flaky {
+        static inline std::atomic<int> tries{0};
+        explicit flaky(int) {
+            std::this_thread::sleep_for(20ms);
+            if (tries++ == 0)
+                throw std::runtime_error("flaky");
+        }
+    };
+    void sharedRetry() {
+        std::atomic<int> threw{0}, got{0};
+        auto get = [&] {
+            try {
+                auto r = one::sharedGet<flaky, int>(1);
+                got += r.get() != nullptr;
+            } catch (const std::runtime_error &) {
+                ++threw;
+            }
+        };
+        std::thread a(get), b(get);
+        a.join();
+        b.join();
+        assert(threw == 1 && got == 1 && flaky::tries == 2);
+        assert((one::oneMethod<flaky, int>::size() == 0));
+    }
+
+    // A bounded registry allocates its nodes by the page of 64 values: around the edges of a page, the last partial one,
+    // and shared holders.
+    void boundedPages() {
+        using B = one::bounded<0, 1000>;
+        using method = one::oneMethod<obj<5>, B>;
+        {
+            one::one<obj<5>, B> a(one::Opt::notUseConditionConstructor{}, 63), b(one::Opt::notUseConditionConstructor{}, 64),
+                c(one::Opt::notUseConditionConstructor{}, 999);
+            assert(method::size() == 3 && method::verified(63) && method::verified(64) && method::verified(999));
+            assert(std::get<0>(c.condition()) == 999);
+            one::one<obj<5>, B> d;
+            assert(!d.init(one::Opt::notUseConditionConstructor{}, 64));
+            one::oneShared<obj<5>, B> r(one::Opt::notUseConditionConstructor{}, 500), s(one::Opt::notUseConditionConstructor{}, 500);
+            assert(method::size() == 4);
+        }
+        assert(method::size() == 0 && !method::verified(64));
+        one::one<obj<5>, B> again(one::Opt::notUseConditionConstructor{}, 64);
+    }
+} // namespace test
+
+int main() {
+    test::failedRetry();
+    test::eraseMiss();
+    test::sharedRetry();
+    test::boundedPages();
+    std::puts("ok");
+    return 0;
+}